@@ -0,0 +1,21 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace eosio {
+    /**
+     *  Assert if the predicate fails and use the supplied message.
+     *
+     *  @ingroup system
+     *
+     *  Example:
+     *  @code
+     *  eosio::check(a == b, "a does not equal b");
+     *  @endcode
+     */
+    inline void check( bool pred, const char* msg ) {
+        if ( !pred ) {
+            fprintf(stderr, "%s\n", msg);
+            abort();
+        }
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// as CDT `eosio/types.h`
+typedef unsigned __int128 uint128_t;
+
+namespace eosio {
+    /**
+     *  Assert if the predicate fails, traps like `eosio_assert` (no message formatting linked)
+     */
+    inline void check( bool pred, const char* msg ) {
+        if ( !pred ) __builtin_trap();
+    }
+}
@@ -0,0 +1,13 @@
+#!/bin/bash
+
+# compile (extra flags are forwarded, e.g. `./accuracy.sh -march=native`)
+g++ -std=c++14 -O2 -o balancer.accuracy.out balancer.accuracy.cpp -I __bench__ -I __tests__ "$@" || exit 1
+
+# differential accuracy & throughput
+./balancer.accuracy.out || exit 1
+
+# again with the AVX2 `pow_batch` kernel where the host supports it
+if grep -qw avx2 /proc/cpuinfo 2>/dev/null; then
+    g++ -std=c++14 -O2 -mavx2 -o balancer.accuracy.out balancer.accuracy.cpp -I __bench__ -I __tests__ "$@" || exit 1
+    ./balancer.accuracy.out || exit 1
+fi
@@ -0,0 +1,308 @@
+#include <eosio/check.hpp>
+#include <uint128_t/uint128_t.cpp>
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+#include <string>
+
+#include "balancer.hpp"
+
+// Differential harness, every variant against a `long double` reference, one JSON object per line:
+// {"name": "...", "weights": "...", "samples": ..., "max_over": ..., "max_under": ..., "max_rel": ..., "max_ulp": ..., "bound": ..., "ns_per_op": ...}
+//
+// - `max_over` / `max_under` - largest error above / below the exact real result, in output units
+// - `max_rel` - largest |error| / exact for exact results of at least one unit, integer outputs exclude one unit of rounding
+// - `max_ulp` - largest |error| in units of the last place of the exact result as a double (double outputs only)
+// - `bound` - enforced `max_rel` of the variant, integer outputs of the double forward curve (`bound` of 1e-15) must also
+//   stay below one unit of `max_over` (never quote a whole unit above the exact curve) wherever a few double roundings
+//   stay below one unit (exact results below 2^50), the harness exits non-zero when any variant fails
+
+static const size_t SAMPLES = 1 << 16;
+static const double MIN_SECONDS = 0.2;
+
+struct sample {
+    uint64_t amount_in;
+    uint64_t reserve_in;
+    uint64_t weight_in;
+    uint64_t reserve_out;
+    uint64_t weight_out;
+    uint8_t fee;
+    long double amount_out;         // exact output of `amount_in`
+    uint64_t target_out;            // output for `get_amount_in`, below `reserve_out`
+    long double target_in;          // exact input of `target_out`
+};
+
+struct market {
+    std::string weights;
+    std::vector<sample> samples;
+};
+
+// exact curve, reserve_out * (1 - (reserve_in / (reserve_in + amount_in_with_fee)) ^ weight_ratio)
+static long double reference_out( const long double amount_in, const sample& s )
+{
+    const long double amount_in_with_fee = amount_in * (10000 - s.fee) / 10000;
+    const long double ratio = static_cast<long double>(s.weight_in) / s.weight_out;
+    return -static_cast<long double>(s.reserve_out) * expm1l(-ratio * log1pl(amount_in_with_fee / s.reserve_in));
+}
+
+// exact inverse, reserve_in * ((reserve_out / (reserve_out - amount_out)) ^ (1 / weight_ratio) - 1) / (1 - fee)
+static long double reference_in( const long double amount_out, const sample& s )
+{
+    const long double ratio = static_cast<long double>(s.weight_out) / s.weight_in;
+    return s.reserve_in * expm1l(-ratio * log1pl(-amount_out / s.reserve_out)) * 10000 / (10000 - s.fee);
+}
+
+// reserves log-uniform in [1e3, 10^max_reserve_exp] (at most 1e19), trades log-uniform in [1e-9, 10] of `reserve_in`,
+// fees in [0, 100] pips, inverse targets uniform in (0, 0.99) of `reserve_out` with exact inputs below 1e18
+static market make_market( const std::string& weights, const uint64_t weight_in, const uint64_t weight_out, const uint32_t seed, const double max_reserve_exp = 15 )
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> reserve_exp(3, max_reserve_exp);
+    std::uniform_real_distribution<double> trade_exp(-9, 1);
+    std::uniform_real_distribution<double> share(0.000001, 0.99);
+    std::uniform_int_distribution<uint64_t> weight(10, 90);
+    std::uniform_int_distribution<int> fee(0, 100);
+
+    market m;
+    m.weights = weights;
+    for ( size_t i = 0; i < SAMPLES; ++i ) {
+        sample s;
+        s.reserve_in = fmin(1e19, pow(10, reserve_exp(rng)));
+        s.reserve_out = fmin(1e19, pow(10, reserve_exp(rng)));
+        s.amount_in = 1 + s.reserve_in * pow(10, trade_exp(rng));
+        s.weight_in = weight_in ? weight_in : weight(rng);
+        s.weight_out = weight_out ? weight_out : weight(rng);
+        s.fee = fee(rng);
+        s.amount_out = reference_out(s.amount_in, s);
+        s.target_out = s.reserve_out * share(rng);
+        s.target_in = reference_in(s.target_out, s);
+        while ( s.target_in > 1e18 ) {
+            s.target_out /= 2;
+            s.target_in = reference_in(s.target_out, s);
+        }
+        m.samples.push_back(s);
+    }
+    return m;
+}
+
+struct error {
+    long double max_over = 0;
+    long double max_under = 0;
+    long double max_rel = 0;
+    long double max_ulp = -1;       // integer outputs
+    long double max_over_resolved = 0;  // `max_over` over exact results below 2^50
+
+    void add( const long double value, const long double exact, const bool floating )
+    {
+        const long double diff = value - exact;
+        if ( diff > max_over ) max_over = diff;
+        if ( exact < 1125899906842624.0L && diff > max_over_resolved ) max_over_resolved = diff;
+        if ( -diff > max_under ) max_under = -diff;
+        const long double excess = floating ? fabsl(diff) : fmaxl(fabsl(diff) - 1, 0);
+        if ( exact >= 1 && excess / exact > max_rel ) max_rel = excess / exact;
+        if ( floating ) {
+            const double rounded = static_cast<double>(exact);
+            const long double ulp = nextafter(rounded, std::numeric_limits<double>::infinity()) - rounded;
+            if ( fabsl(diff) / ulp > max_ulp ) max_ulp = fabsl(diff) / ulp;
+        }
+    }
+};
+
+static volatile double sink;
+static size_t failures = 0;
+
+// `value(s)` returns one variant output, evaluated over every sample for accuracy then repeated for throughput
+template <typename F>
+static void run( const std::string& name, const market& m, const bool inverse, const bool floating, const long double bound, F value )
+{
+    typedef std::chrono::steady_clock clock;
+    error e;
+    for ( const sample& s : m.samples ) e.add(value(s), inverse ? s.target_in : s.amount_out, floating);
+
+    uint64_t ops = 0;
+    double acc = 0;
+    const clock::time_point start = clock::now();
+    double elapsed = 0;
+    while ( elapsed < MIN_SECONDS ) {
+        for ( const sample& s : m.samples ) acc += value(s);
+        ops += m.samples.size();
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    sink = acc;
+    printf("{\"name\": \"%s\", \"weights\": \"%s\", \"samples\": %zu, \"max_over\": %.3Lg, \"max_under\": %.3Lg, \"max_rel\": %.3Lg, \"max_ulp\": %.3Lg, \"bound\": %.3Lg, \"ns_per_op\": %.2f}\n",
+           name.c_str(), m.weights.c_str(), m.samples.size(), e.max_over, e.max_under, e.max_rel, e.max_ulp, bound, elapsed * 1e9 / ops);
+
+    // enforced bounds
+    const bool over = !inverse && !floating && bound <= 1e-15 && e.max_over_resolved >= 1;
+    if ( e.max_rel > bound || over ) {
+        fprintf(stderr, "FAILED: %s (%s) max_rel %.3Lg > %.3Lg or max_over %.3Lg >= 1\n", name.c_str(), m.weights.c_str(), e.max_rel, bound, e.max_over_resolved);
+        ++failures;
+    }
+}
+
+// `batch(outputs)` writes one output per sample, each must equal `get_amount_out` exactly (`bound` 0, `mismatches` counted)
+template <typename F>
+static void run_identical( const std::string& name, const market& m, F batch )
+{
+    typedef std::chrono::steady_clock clock;
+    std::vector<uint64_t> outputs(m.samples.size());
+    batch(outputs.data());
+    size_t mismatches = 0;
+    for ( size_t i = 0; i < m.samples.size(); ++i ) {
+        const sample& s = m.samples[i];
+        if ( outputs[i] != balancer::get_amount_out<balancer::unchecked>(s.amount_in, s.reserve_in, s.weight_in, s.reserve_out, s.weight_out, s.fee) ) ++mismatches;
+    }
+
+    uint64_t ops = 0;
+    const clock::time_point start = clock::now();
+    double elapsed = 0;
+    while ( elapsed < MIN_SECONDS ) {
+        batch(outputs.data());
+        ops += m.samples.size();
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    sink = outputs[0];
+    printf("{\"name\": \"%s\", \"weights\": \"%s\", \"samples\": %zu, \"mismatches\": %zu, \"bound\": 0, \"ns_per_op\": %.2f}\n",
+           name.c_str(), m.weights.c_str(), m.samples.size(), mismatches, elapsed * 1e9 / ops);
+
+    if ( mismatches > 0 ) {
+        fprintf(stderr, "FAILED: %s (%s) %zu outputs differ from get_amount_out\n", name.c_str(), m.weights.c_str(), mismatches);
+        ++failures;
+    }
+}
+
+// `pow_batch` over the curve numerators `x = reserve_in / (reserve_in + amount_in_with_fee)` and `y = weight_ratio`,
+// `max_excess` is the largest error relative to its documented bound `(2 + 3 * |y * log(x)|) * 2^-53` (`bound` 1)
+static void run_pow_batch( const market& m )
+{
+    typedef std::chrono::steady_clock clock;
+    const size_t count = m.samples.size();
+    std::vector<double> x(count), y(count), z(count);
+    for ( size_t i = 0; i < count; ++i ) {
+        const sample& s = m.samples[i];
+        const double reserve_in_scaled = static_cast<double>(s.reserve_in) * 10000;
+        x[i] = reserve_in_scaled / (reserve_in_scaled + static_cast<double>(s.amount_in) * (10000 - s.fee));
+        y[i] = static_cast<double>(s.weight_in) / s.weight_out;
+    }
+    balancer::pow_batch(x.data(), y.data(), z.data(), count);
+    long double max_ulp = 0;
+    long double max_excess = 0;
+    for ( size_t i = 0; i < count; ++i ) {
+        const long double exact = powl(x[i], y[i]);
+        const long double diff = fabsl(z[i] - exact);
+        const double rounded = static_cast<double>(exact);
+        const long double ulp = nextafter(rounded, std::numeric_limits<double>::infinity()) - rounded;
+        const long double bound = (2 + 3 * fabsl(y[i] * logl(x[i]))) * exact / 9007199254740992.0L;
+        max_ulp = fmaxl(max_ulp, diff / ulp);
+        max_excess = fmaxl(max_excess, diff / bound);
+    }
+
+    uint64_t ops = 0;
+    const clock::time_point start = clock::now();
+    double elapsed = 0;
+    while ( elapsed < MIN_SECONDS ) {
+        balancer::pow_batch(x.data(), y.data(), z.data(), count);
+        ops += count;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    sink = z[0];
+    printf("{\"name\": \"pow_batch\", \"weights\": \"%s\", \"samples\": %zu, \"max_ulp\": %.3Lg, \"max_excess\": %.3Lg, \"bound\": 1, \"ns_per_op\": %.2f}\n",
+           m.weights.c_str(), count, max_ulp, max_excess, elapsed * 1e9 / ops);
+
+    if ( max_excess > 1 ) {
+        fprintf(stderr, "FAILED: pow_batch (%s) error %.3Lg of its bound\n", m.weights.c_str(), max_excess);
+        ++failures;
+    }
+}
+
+int main()
+{
+    // an 80-bit (or wider) `long double` resolves about 1/2048 ULP of a double, `simd` is the `pow_batch` kernel
+#if defined(__AVX2__)
+    const char* simd = "avx2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const char* simd = "neon";
+#else
+    const char* simd = "scalar";
+#endif
+    printf("{\"reference_bits\": %d, \"simd\": \"%s\"}\n", std::numeric_limits<long double>::digits, simd);
+
+    std::vector<market> markets;
+    markets.push_back(make_market("50/50", 50, 50, 1));
+    markets.push_back(make_market("20/80", 20, 80, 2));
+    markets.push_back(make_market("80/20", 80, 20, 3));
+    markets.push_back(make_market("random", 0, 0, 4));
+    markets.push_back(make_market("deep", 0, 0, 5, 19));
+
+    for ( size_t k = 0; k < markets.size(); ++k ) {
+        const market& m = markets[k];
+
+        // one table per weight pair, built outside the timed loop
+        std::map<std::pair<uint64_t, uint64_t>, balancer::curve_table> tables;
+        for ( const sample& s : m.samples ) tables.emplace(std::make_pair(s.weight_in, s.weight_out), balancer::curve_table(s.weight_in, s.weight_out));
+        std::vector<const balancer::curve_table*> table;
+        std::vector<balancer::pool> pools;
+        for ( const sample& s : m.samples ) {
+            table.push_back(&tables.at(std::make_pair(s.weight_in, s.weight_out)));
+            pools.push_back(balancer::pool(s.reserve_in, s.weight_in, s.reserve_out, s.weight_out, s.fee));
+        }
+        const sample* base = m.samples.data();
+
+        run("get_amount_out", m, false, false, 1e-15, [&](const sample& s) {
+            return balancer::get_amount_out<balancer::unchecked>(s.amount_in, s.reserve_in, s.weight_in, s.reserve_out, s.weight_out, s.fee);
+        });
+        run("get_amount_out_fixed", m, false, false, 1e-8, [&](const sample& s) {
+            return balancer::get_amount_out_fixed<balancer::unchecked>(s.amount_in, s.reserve_in, s.weight_in, s.reserve_out, s.weight_out, s.fee);
+        });
+        run("get_amount_out_approx", m, false, true, balancer::APPROX_MAX_ERROR, [&](const sample& s) {
+            return balancer::get_amount_out_approx<balancer::unchecked>(s.amount_in, s.reserve_in, s.weight_in, s.reserve_out, s.weight_out, s.fee);
+        });
+        run("curve_table::amount_out", m, false, false, 1e-15, [&](const sample& s) {
+            return table[&s - base]->amount_out<balancer::unchecked>(s.amount_in, s.reserve_in, s.reserve_out, s.fee);
+        });
+        run("pool::amount_out", m, false, false, 1e-15, [&](const sample& s) {
+            return pools[&s - base].amount_out<balancer::unchecked>(s.amount_in);
+        });
+        run("pool::amount_out_precise", m, false, true, 4e-15, [&](const sample& s) {
+            return pools[&s - base].amount_out_precise<balancer::unchecked>(s.amount_in);
+        });
+        run("pool::amount_out_approx", m, false, true, balancer::APPROX_MAX_ERROR, [&](const sample& s) {
+            return pools[&s - base].amount_out_approx<balancer::unchecked>(s.amount_in);
+        });
+        run("get_amount_in", m, true, false, 1e-12, [&](const sample& s) {
+            return balancer::get_amount_in<balancer::unchecked>(s.target_out, s.reserve_in, s.weight_in, s.reserve_out, s.weight_out, s.fee);
+        });
+        run("pool::amount_in", m, true, false, 1e-14, [&](const sample& s) {
+            return pools[&s - base].amount_in<balancer::unchecked>(s.target_out);
+        });
+        run("pool::amount_in_exact", m, true, false, 1e-12, [&](const sample& s) {
+            return pools[&s - base].amount_in_exact<balancer::unchecked>(s.target_out);
+        });
+
+        // batch paths, structure-of-arrays columns built outside the timed loop
+        std::vector<uint64_t> amounts_in, reserves_in, weights_in, reserves_out, weights_out;
+        std::vector<uint8_t> fees;
+        for ( const sample& s : m.samples ) {
+            amounts_in.push_back(s.amount_in);
+            reserves_in.push_back(s.reserve_in);
+            weights_in.push_back(s.weight_in);
+            reserves_out.push_back(s.reserve_out);
+            weights_out.push_back(s.weight_out);
+            fees.push_back(s.fee);
+        }
+        run_identical("get_amount_out_soa", m, [&](uint64_t* outputs) {
+            balancer::get_amount_out_soa<balancer::unchecked>(amounts_in.data(), outputs, m.samples.size(), reserves_in.data(), weights_in.data(), reserves_out.data(), weights_out.data(), fees.data());
+        });
+        run_identical("get_amount_out_batch", m, [&](uint64_t* outputs) {
+            for ( size_t i = 0; i < m.samples.size(); ++i ) {
+                balancer::get_amount_out_batch<balancer::unchecked>(&amounts_in[i], &outputs[i], 1, reserves_in[i], weights_in[i], reserves_out[i], weights_out[i], fees[i]);
+            }
+        });
+        run_pow_batch(m);
+    }
+    return failures == 0 ? 0 : 1;
+}
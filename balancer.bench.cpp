@@ -0,0 +1,287 @@
+#include <eosio/check.hpp>
+#include <uint128_t/uint128_t.cpp>
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+
+#include "balancer.hpp"
+#include "balancer.engine.hpp"
+
+// Microbenchmarks, one JSON object per line:
+// {"name": "...", "weights": "...", "ns_per_op": ..., "ops_per_sec": ..., "ops": ...}
+
+static const size_t SAMPLES = 4096;
+static const double MIN_SECONDS = 0.2;
+
+struct market {
+    std::string weights;
+    std::vector<uint64_t> amounts_in;
+    std::vector<uint64_t> amounts_out;
+    std::vector<uint64_t> reserves_in;
+    std::vector<uint64_t> reserves_out;
+    std::vector<uint64_t> weights_in;
+    std::vector<uint64_t> weights_out;
+    std::vector<uint8_t> fees;
+};
+
+// reserves log-uniform in [1e6, 1e9], trades log-uniform in [1e-6, 1e-3] of `reserve_in` (keeps `quote` within 64 bits)
+static market make_market( const std::string& weights, const uint64_t weight_in, const uint64_t weight_out, const uint32_t seed )
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> reserve_exp(6, 9);
+    std::uniform_real_distribution<double> trade_exp(-6, -3);
+    std::uniform_int_distribution<uint64_t> weight(10, 90);
+
+    market m;
+    m.weights = weights;
+    for ( size_t i = 0; i < SAMPLES; ++i ) {
+        const uint64_t reserve_in = pow(10, reserve_exp(rng));
+        const uint64_t reserve_out = pow(10, reserve_exp(rng));
+        const uint64_t amount_in = 1 + reserve_in * pow(10, trade_exp(rng));
+        const uint64_t w_in = weight_in ? weight_in : weight(rng);
+        const uint64_t w_out = weight_out ? weight_out : weight(rng);
+
+        m.reserves_in.push_back(reserve_in);
+        m.reserves_out.push_back(reserve_out);
+        m.amounts_in.push_back(amount_in);
+        m.weights_in.push_back(w_in);
+        m.weights_out.push_back(w_out);
+        m.fees.push_back(30);
+        m.amounts_out.push_back(balancer::get_amount_out(amount_in, reserve_in, w_in, reserve_out, w_out) / 2 + 1);
+    }
+    return m;
+}
+
+static volatile uint64_t sink;
+
+// runs `fn` (which evaluates `ops_per_call` operations) until `MIN_SECONDS` elapsed
+template <typename F>
+static void run( const std::string& name, const market& m, const size_t ops_per_call, F fn )
+{
+    typedef std::chrono::steady_clock clock;
+    uint64_t ops = 0;
+    uint64_t acc = 0;
+    const clock::time_point start = clock::now();
+    double elapsed = 0;
+
+    while ( elapsed < MIN_SECONDS ) {
+        for ( int i = 0; i < 16; ++i ) acc += fn();
+        ops += 16 * ops_per_call;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    sink = acc;
+    printf("{\"name\": \"%s\", \"weights\": \"%s\", \"ns_per_op\": %.2f, \"ops_per_sec\": %.0f, \"ops\": %llu}\n",
+           name.c_str(), m.weights.c_str(), elapsed * 1e9 / ops, ops / elapsed, static_cast<unsigned long long>(ops));
+}
+
+int main()
+{
+    std::vector<market> markets;
+    markets.push_back(make_market("50/50", 50, 50, 1));
+    markets.push_back(make_market("20/80", 20, 80, 2));
+    markets.push_back(make_market("80/20", 80, 20, 3));
+    markets.push_back(make_market("random", 0, 0, 4));
+
+    balancer::quote_engine engine;
+    for ( size_t k = 0; k < markets.size(); ++k ) {
+        const market& m = markets[k];
+
+        run("get_amount_out", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += balancer::get_amount_out(m.amounts_in[i], m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i]);
+            return acc;
+        });
+        run("get_amount_out<unchecked>", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += balancer::get_amount_out<balancer::unchecked>(m.amounts_in[i], m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i]);
+            return acc;
+        });
+        run("get_amount_out_approx", m, SAMPLES, [&]() {
+            double acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += balancer::get_amount_out_approx(m.amounts_in[i], m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i]);
+            return static_cast<uint64_t>(acc);
+        });
+        run("get_amount_out_with_derivative", m, SAMPLES, [&]() {
+            double acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) {
+                const balancer::curve_point point = balancer::get_amount_out_with_derivative(m.amounts_in[i], m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i]);
+                acc += point.amount_out + point.derivative + point.second_derivative;
+            }
+            return static_cast<uint64_t>(acc);
+        });
+        run("get_amount_out_with_fees", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) {
+                const balancer::fee_split split = balancer::get_amount_out_with_fees(m.amounts_in[i], m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i], 25, 5);
+                acc += split.amount_out + split.trade_fee + split.protocol_fee;
+            }
+            return acc;
+        });
+        run("get_amount_in", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += balancer::get_amount_in(m.amounts_out[i], m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i]);
+            return acc;
+        });
+        run("quote", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += balancer::quote(m.amounts_in[i], m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i]);
+            return acc;
+        });
+        run("quote_batch", m, SAMPLES, [&]() {
+            static uint64_t amounts_b[SAMPLES];
+            balancer::quote_batch(m.amounts_in.data(), amounts_b, SAMPLES, m.reserves_in[0], m.weights_in[0], m.reserves_out[0], m.weights_out[0]);
+            return amounts_b[SAMPLES - 1];
+        });
+        run("quote (same pool)", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += balancer::quote(m.amounts_in[i], m.reserves_in[0], m.weights_in[0], m.reserves_out[0], m.weights_out[0]);
+            return acc;
+        });
+        run("get_amount_out_fixed", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += balancer::get_amount_out_fixed(m.amounts_in[i], m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i]);
+            return acc;
+        });
+        run("get_amount_in_fixed", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += balancer::get_amount_in_fixed(m.amounts_out[i], m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i]);
+            return acc;
+        });
+        run("get_amount_out_soa", m, SAMPLES, [&]() {
+            static uint64_t amounts_out[SAMPLES];
+            balancer::get_amount_out_soa(m.amounts_in.data(), amounts_out, SAMPLES, m.reserves_in.data(), m.weights_in.data(), m.reserves_out.data(), m.weights_out.data(), m.fees.data());
+            return amounts_out[SAMPLES - 1];
+        });
+
+        const balancer::snapshot pools = { SAMPLES, m.reserves_in.data(), m.weights_in.data(), m.reserves_out.data(), m.weights_out.data(), m.fees.data() };
+        const uint64_t tiers[] = { 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000, 10000000000 };
+        run("quote_engine::get_amounts_out", m, SAMPLES * 8, [&]() {
+            static uint64_t results[SAMPLES * 8];
+            engine.get_amounts_out(pools, tiers, 8, results);
+            return results[SAMPLES * 8 - 1];
+        });
+
+        // pairs over 256 tokens, 3-hop search (ops = searches)
+        std::vector<balancer::route_pair> pairs;
+        for ( size_t i = 0; i < SAMPLES; ++i ) {
+            const uint32_t a = (i * 7919) % 256;
+            const uint32_t b = (a + 1 + (i * 104729) % 255) % 256;
+            pairs.push_back({ a, b, m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i], 30 });
+        }
+        balancer::route_graph graph(256, pairs.data(), pairs.size());
+        run("route_graph::best_route", m, 16, [&]() {
+            uint64_t acc = 0;
+            for ( uint32_t to = 1; to <= 16; ++to ) acc += graph.best_route(0, to, 1000000, 3).amount_out;
+            return acc;
+        });
+
+        // price stream, 1024 subscribed routes, one swap per block then every quote read (ops = blocks)
+        balancer::quote_stream stream(graph);
+        std::vector<balancer::route> routes;
+        for ( uint32_t to = 1; to <= 255 && routes.size() < 1024; ++to ) {
+            for ( uint32_t from = 0; from < 4; ++from ) {
+                const balancer::route route = graph.best_route(from, to, 1000000, 2);
+                if ( route.hops ) {
+                    stream.subscribe(route, 1000000);
+                    routes.push_back(route);
+                }
+            }
+        }
+        size_t block = 0;
+        run("quote_stream (1 swap, read all)", m, 1, [&]() {
+            const size_t edge = (block++ * 7919) % graph.edge_count();
+            stream.apply_swap(edge, 1, 0);
+            uint64_t acc = 0;
+            for ( size_t id = 0; id < stream.size(); ++id ) acc += stream.quote(id);
+            return acc;
+        });
+        run("route_graph::amount_out (requote all)", m, 1, [&]() {
+            uint64_t acc = 0;
+            for ( const balancer::route& route : routes ) acc += graph.amount_out(route, 1000000);
+            return acc;
+        });
+
+        // cold start, parse every pool vs map a snapshot (ops = pools)
+        run("pool (construct all)", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += static_cast<uint64_t>(balancer::pool(m.reserves_in[i], m.weights_in[i], m.reserves_out[i], m.weights_out[i], m.fees[i]).spot_price);
+            return acc;
+        });
+        balancer::write_snapshot("balancer.bench.snapshot.out", pools);
+        run("mapped_snapshot (open)", m, SAMPLES, [&]() {
+            const balancer::mapped_snapshot file("balancer.bench.snapshot.out");
+            return file.pools().reserves_in[SAMPLES - 1] + file.pools().weights_in[SAMPLES - 1];
+        });
+        const balancer::mapped_snapshot file("balancer.bench.snapshot.out");
+        run("mapped_snapshot::pool (construct all)", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += static_cast<uint64_t>(file.pool(i).spot_price);
+            return acc;
+        });
+        std::remove("balancer.bench.snapshot.out");
+
+        // one pool, many amounts
+        const balancer::pool pool(m.reserves_in[0], m.weights_in[0], m.reserves_out[0], m.weights_out[0]);
+        std::vector<uint64_t> amounts_in(SAMPLES);
+        for ( size_t i = 0; i < SAMPLES; ++i ) amounts_in[i] = 1 + m.amounts_in[i] % (pool.reserve_in / 10 + 1);
+
+        run("get_amount_out_batch", m, SAMPLES, [&]() {
+            static uint64_t amounts_out[SAMPLES];
+            balancer::get_amount_out_batch(amounts_in.data(), amounts_out, SAMPLES, pool.reserve_in, pool.reserve_weight_in, pool.reserve_out, pool.reserve_weight_out);
+            return amounts_out[SAMPLES - 1];
+        });
+        run("pool::amount_out", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += pool.amount_out(amounts_in[i]);
+            return acc;
+        });
+        run("pool::amount_out<unchecked>", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += pool.amount_out<balancer::unchecked>(amounts_in[i]);
+            return acc;
+        });
+        const balancer::curve_table table(pool.reserve_weight_in, pool.reserve_weight_out);
+        run("curve_table::amount_out", m, SAMPLES, [&]() {
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += table.amount_out(amounts_in[i], pool.reserve_in, pool.reserve_out);
+            return acc;
+        });
+        run("pool::amount_out_approx", m, SAMPLES, [&]() {
+            double acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) acc += pool.amount_out_approx(amounts_in[i]);
+            return static_cast<uint64_t>(acc);
+        });
+        run("sample_curve_geometric", m, 200, [&]() {
+            static uint64_t ladder_in[200];
+            static uint64_t ladder_out[200];
+            balancer::sample_curve_geometric(pool, 1, pool.reserve_in, ladder_in, ladder_out, 200);
+            return ladder_out[199];
+        });
+
+        // replayed swap events, incremental update vs rebuild
+        run("pool::apply_swap", m, SAMPLES, [&]() {
+            balancer::pool state = pool;
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) {
+                state.apply_swap(amounts_in[i], 1);
+                acc += static_cast<uint64_t>(state.spot_price) + static_cast<uint64_t>(state.weighted_reserve_in);
+            }
+            return acc;
+        });
+        run("pool (rebuild)", m, SAMPLES, [&]() {
+            uint64_t reserve_in = pool.reserve_in;
+            uint64_t reserve_out = pool.reserve_out;
+            uint64_t acc = 0;
+            for ( size_t i = 0; i < SAMPLES; ++i ) {
+                reserve_in += amounts_in[i];
+                reserve_out -= 1;
+                const balancer::pool state(reserve_in, pool.reserve_weight_in, reserve_out, pool.reserve_weight_out);
+                acc += static_cast<uint64_t>(state.spot_price) + static_cast<uint64_t>(state.weighted_reserve_in);
+            }
+            return acc;
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,886 @@
+#pragma once
+
+#include "balancer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Host-only (off-chain) helpers, require `<thread>` and POSIX `mmap`, not part of the contract build
+
+namespace balancer {
+    /**
+     * Structure-of-arrays view of a pool universe (non-owning), same layout as `get_amount_out_soa`
+     */
+    struct snapshot {
+        size_t size;                    // number of pools
+        const uint64_t* reserves_in;
+        const uint64_t* weights_in;
+        const uint64_t* reserves_out;
+        const uint64_t* weights_out;
+        const uint8_t* fees;
+    };
+
+    /**
+     * ## STRUCT `quote_engine`
+     *
+     * Persistent thread pool quoting every pool of a `snapshot` against a grid of input amounts
+     *
+     * Workers claim `CHUNK` pools at a time from a shared counter (idle threads keep pulling work until the sweep is done),
+     * each pool row is evaluated with `get_amount_out_batch`, so every cell is identical to `get_amount_out` (double build, see
+     * On-chain profile) regardless of the thread count or scheduling. Inputs are validated on the calling thread, sweeps
+     * allocate nothing
+     *
+     * ### params
+     *
+     * - `{size_t} [threads=0]` - (optional) threads including the caller, `0` for `std::thread::hardware_concurrency()`
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t reserves_in[] = { 45851931234, 833515447 };
+     * const uint64_t weights_in[] = { 50000, 20 };
+     * const uint64_t reserves_out[] = { 125682033533, 10395237882 };
+     * const uint64_t weights_out[] = { 50000, 80 };
+     * const uint8_t fees[] = { 30, 30 };
+     * const balancer::snapshot pools = { 2, reserves_in, weights_in, reserves_out, weights_out, fees };
+     * const uint64_t amounts_in[] = { 10000, 100000 };
+     *
+     * // Calculation
+     * balancer::quote_engine engine;
+     * uint64_t results[4];    // pools x amounts, row-major
+     * engine.get_amounts_out( pools, amounts_in, 2, results );
+     * // => [ 27328, 273281, 31085, 310830 ]
+     * ```
+     */
+    class quote_engine {
+    public:
+        static constexpr size_t CHUNK = 16;     // pools claimed per step
+
+        explicit quote_engine( const size_t threads = 0 )
+            : generation( 0 ),
+              pending( 0 ),
+              stopping( false ),
+              next( 0 )
+        {
+            const size_t count = threads ? threads : std::thread::hardware_concurrency();
+            for ( size_t i = 1; i < count; ++i ) workers.emplace_back(&quote_engine::worker, this);
+        }
+
+        ~quote_engine()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            start.notify_all();
+            for ( std::thread& thread : workers ) thread.join();
+        }
+
+        quote_engine( const quote_engine& ) = delete;
+        quote_engine& operator=( const quote_engine& ) = delete;
+
+        /**
+         * Threads evaluating a sweep, including the caller
+         */
+        size_t threads() const
+        {
+            return workers.size() + 1;
+        }
+
+        /**
+         * Maximum output amount of every pool for every input amount, `results[pool * count + i]` (see `get_amount_out`)
+         */
+        template <typename Check = checked>
+        void get_amounts_out( const snapshot& pools, const uint64_t* amounts_in, const size_t count, uint64_t* results )
+        {
+            std::lock_guard<std::mutex> guard(sweep);
+
+            // checks, on the calling thread
+            for ( size_t i = 0; i < count; ++i ) {
+                Check::check(amounts_in[i] > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            }
+            for ( size_t i = 0; i < pools.size; ++i ) {
+                Check::check(pools.reserves_in[i] > 0 && pools.reserves_out[i] > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+                Check::check(pools.weights_in[i] > 0 && pools.weights_out[i] > 0, "SX.Balancer: INVALID_WEIGHT");
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job.pools = &pools;
+                job.amounts_in = amounts_in;
+                job.count = count;
+                job.results = results;
+                next.store(0, std::memory_order_relaxed);
+                pending = workers.size();
+                ++generation;
+            }
+            start.notify_all();
+            work();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return pending == 0; });
+        }
+
+    private:
+        struct sweep_job {
+            const snapshot* pools;
+            const uint64_t* amounts_in;
+            size_t count;
+            uint64_t* results;
+        };
+
+        void worker()
+        {
+            uint64_t seen = 0;
+            while ( true ) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    start.wait(lock, [this, seen]() { return stopping || generation != seen; });
+                    if ( stopping ) return;
+                    seen = generation;
+                }
+                work();
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if ( --pending == 0 ) done.notify_one();
+            }
+        }
+
+        void work()
+        {
+            const snapshot& pools = *job.pools;
+            while ( true ) {
+                const size_t begin = next.fetch_add(CHUNK, std::memory_order_relaxed);
+                if ( begin >= pools.size ) return;
+
+                const size_t end = begin + CHUNK < pools.size ? begin + CHUNK : pools.size;
+                for ( size_t i = begin; i < end; ++i ) {
+                    get_amount_out_batch<unchecked>(job.amounts_in, job.results + i * job.count, job.count, pools.reserves_in[i], pools.weights_in[i], pools.reserves_out[i], pools.weights_out[i], pools.fees[i]);
+                }
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::mutex sweep;                       // one sweep at a time
+        std::mutex mutex;
+        std::condition_variable start;
+        std::condition_variable done;
+        uint64_t generation;
+        size_t pending;                         // workers still in the current sweep
+        bool stopping;
+        sweep_job job;
+        std::atomic<size_t> next;               // next unclaimed pool
+    };
+
+    // snapshot file format (see `snapshot_header`)
+    static constexpr char SNAPSHOT_MAGIC[8] = { 'S', 'X', 'B', 'A', 'L', 'S', 'N', 'P' };
+    static constexpr uint32_t SNAPSHOT_VERSION = 3;
+    static constexpr uint32_t SNAPSHOT_ENDIAN = 0x01020304;
+    static constexpr uint64_t SNAPSHOT_ALIGN = 64;
+
+    /**
+     * ## STRUCT `snapshot_header`
+     *
+     * Versioned binary pool snapshot, structure-of-arrays columns after a fixed header (see `write_snapshot`)
+     *
+     * Every column starts on a `SNAPSHOT_ALIGN` boundary and is addressed by its byte offset from the start of the file,
+     * the raw columns read by the batch APIs (reserves, weights, fees) are followed by the cached weight terms of `pool`
+     * (curve kinds and weight ratios, both directions), values are stored in host byte order and tagged with `endian` so
+     * a foreign file is rejected instead of misread
+     */
+    struct snapshot_header {
+        enum column {
+            reserves_in,                // uint64_t
+            weights_in,                 // uint64_t
+            reserves_out,               // uint64_t
+            weights_out,                // uint64_t
+            fees,                       // uint8_t
+            kinds,                      // curve_kind, get_curve_kind( weight_in, weight_out )
+            inverse_kinds,              // curve_kind, get_curve_kind( weight_out, weight_in )
+            weight_ratios,              // double, weight_in / weight_out
+            inverse_ratios,             // double, weight_out / weight_in
+            COLUMNS
+        };
+
+        char magic[8];                  // SNAPSHOT_MAGIC
+        uint32_t version;               // SNAPSHOT_VERSION
+        uint32_t endian;                // SNAPSHOT_ENDIAN as written by the host
+        uint64_t size;                  // number of pools
+        uint64_t bytes;                 // file size
+        uint64_t offsets[COLUMNS];      // byte offset of every column
+    };
+
+    namespace detail {
+        static const uint64_t SNAPSHOT_WIDTHS[snapshot_header::COLUMNS] = { 8, 8, 8, 8, 1, 1, 1, 8, 8 };
+
+        // column offsets and file size of a snapshot of `size` pools
+        inline uint64_t snapshot_layout( const uint64_t size, uint64_t* offsets )
+        {
+            uint64_t offset = sizeof(snapshot_header);
+            for ( size_t c = 0; c < snapshot_header::COLUMNS; ++c ) {
+                offset = (offset + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+                offsets[c] = offset;
+                offset += size * SNAPSHOT_WIDTHS[c];
+            }
+            return offset;
+        }
+    }
+
+    /**
+     * ## STATIC `write_snapshot`
+     *
+     * Writes every pool of a `snapshot` to a binary file (see `snapshot_header`)
+     *
+     * Rows are validated as `pool`, the file is written next to `path` and renamed over it, so processes mapping the
+     * previous file keep a consistent view until they reopen it
+     *
+     * ### params
+     *
+     * - `{const char*} path` - output file
+     * - `{snapshot} pools` - pools to store
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t reserves_in[] = { 45851931234, 833515447 };
+     * const uint64_t weights_in[] = { 50000, 20 };
+     * const uint64_t reserves_out[] = { 125682033533, 10395237882 };
+     * const uint64_t weights_out[] = { 50000, 80 };
+     * const uint8_t fees[] = { 30, 30 };
+     * const balancer::snapshot pools = { 2, reserves_in, weights_in, reserves_out, weights_out, fees };
+     *
+     * // Calculation
+     * balancer::write_snapshot( "pools.snapshot", pools );
+     * ```
+     */
+    inline void write_snapshot( const char* path, const snapshot& pools )
+    {
+        snapshot_header header = {};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.endian = SNAPSHOT_ENDIAN;
+        header.size = pools.size;
+        header.bytes = detail::snapshot_layout(pools.size, header.offsets);
+
+        std::vector<unsigned char> buffer(header.bytes);
+        unsigned char* data = buffer.data();
+        std::memcpy(data, &header, sizeof(header));
+
+        const uint64_t* offsets = header.offsets;
+        for ( size_t i = 0; i < pools.size; ++i ) {
+            const pool row(pools.reserves_in[i], pools.weights_in[i], pools.reserves_out[i], pools.weights_out[i], pools.fees[i]);
+
+            std::memcpy(data + offsets[snapshot_header::reserves_in] + i * 8, &row.reserve_in, 8);
+            std::memcpy(data + offsets[snapshot_header::weights_in] + i * 8, &row.reserve_weight_in, 8);
+            std::memcpy(data + offsets[snapshot_header::reserves_out] + i * 8, &row.reserve_out, 8);
+            std::memcpy(data + offsets[snapshot_header::weights_out] + i * 8, &row.reserve_weight_out, 8);
+            std::memcpy(data + offsets[snapshot_header::fees] + i, &row.fee, 1);
+            std::memcpy(data + offsets[snapshot_header::kinds] + i, &row.kind, 1);
+            std::memcpy(data + offsets[snapshot_header::inverse_kinds] + i, &row.inverse_kind, 1);
+            std::memcpy(data + offsets[snapshot_header::weight_ratios] + i * 8, &row.weight_ratio, 8);
+            std::memcpy(data + offsets[snapshot_header::inverse_ratios] + i * 8, &row.inverse_ratio, 8);
+        }
+
+        // write aside, then replace atomically
+        const std::string temporary = std::string(path) + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        eosio::check(file != nullptr, "SX.Balancer: SNAPSHOT_OPEN");
+        const bool written = std::fwrite(data, 1, buffer.size(), file) == buffer.size();
+        const bool closed = std::fclose(file) == 0;
+        eosio::check(written && closed, "SX.Balancer: SNAPSHOT_WRITE");
+        eosio::check(std::rename(temporary.c_str(), path) == 0, "SX.Balancer: SNAPSHOT_WRITE");
+    }
+
+    /**
+     * ## STRUCT `mapped_snapshot`
+     *
+     * Read-only, zero-copy view of a snapshot file (see `write_snapshot`), mapped with `mmap(MAP_SHARED)`
+     *
+     * Opening validates the header, the column bounds and the cached weight terms (one read-only pass comparing every
+     * stored kind / ratio with the weights, a stale or foreign cache is rejected), pool rows are never copied: `pools()`
+     * points the raw columns straight into the mapping for `quote_engine` / `get_amount_out_soa` and `pool( i )` builds a
+     * `pool` from the cached terms, processes mapping the same file share one page-cached copy
+     *
+     * ### params
+     *
+     * - `{const char*} path` - snapshot file
+     *
+     * ### example
+     *
+     * ```c++
+     * // Load
+     * const balancer::mapped_snapshot file( "pools.snapshot" );
+     * const uint64_t amounts_in[] = { 10000, 100000 };
+     *
+     * // Calculation
+     * balancer::quote_engine engine;
+     * uint64_t results[4];    // pools x amounts, row-major
+     * engine.get_amounts_out( file.pools(), amounts_in, 2, results );
+     * // => [ 27328, 273281, 31085, 310830 ]
+     * ```
+     */
+    class mapped_snapshot {
+    public:
+        explicit mapped_snapshot( const char* path )
+            : data( nullptr ),
+              bytes( 0 )
+        {
+            const int fd = ::open(path, O_RDONLY);
+            eosio::check(fd >= 0, "SX.Balancer: SNAPSHOT_OPEN");
+            struct stat info;
+            const bool sized = ::fstat(fd, &info) == 0 && static_cast<uint64_t>(info.st_size) >= sizeof(snapshot_header);
+            void* mapping = sized ? ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+            ::close(fd);
+            eosio::check(mapping != MAP_FAILED, "SX.Balancer: SNAPSHOT_OPEN");
+
+            // checks, header and layout (unmapped before raising, the destructor does not run when the constructor throws)
+            const char* error = validate(static_cast<const unsigned char*>(mapping), info.st_size);
+            if ( error ) ::munmap(mapping, info.st_size);
+            eosio::check(error == nullptr, error);
+            data = static_cast<const unsigned char*>(mapping);
+            bytes = info.st_size;
+
+            view.size = reinterpret_cast<const snapshot_header*>(data)->size;
+            view.reserves_in = column<uint64_t>(snapshot_header::reserves_in);
+            view.weights_in = column<uint64_t>(snapshot_header::weights_in);
+            view.reserves_out = column<uint64_t>(snapshot_header::reserves_out);
+            view.weights_out = column<uint64_t>(snapshot_header::weights_out);
+            view.fees = column<uint8_t>(snapshot_header::fees);
+            kinds = column<curve_kind>(snapshot_header::kinds);
+            inverse_kinds = column<curve_kind>(snapshot_header::inverse_kinds);
+            weight_ratios = column<double>(snapshot_header::weight_ratios);
+            inverse_ratios = column<double>(snapshot_header::inverse_ratios);
+        }
+
+        ~mapped_snapshot()
+        {
+            if ( data ) ::munmap(const_cast<unsigned char*>(data), bytes);
+        }
+
+        mapped_snapshot( const mapped_snapshot& ) = delete;
+        mapped_snapshot& operator=( const mapped_snapshot& ) = delete;
+
+        /**
+         * Number of pools
+         */
+        size_t size() const
+        {
+            return view.size;
+        }
+
+        /**
+         * Raw columns as a `snapshot`, valid while the mapping is alive
+         */
+        const snapshot& pools() const
+        {
+            return view;
+        }
+
+        /**
+         * Pool `i` built from the cached weight terms (see `pool`)
+         */
+        balancer::pool pool( const size_t i ) const
+        {
+            eosio::check(i < view.size, "SX.Balancer: INVALID_POOL");
+            return balancer::pool(view.reserves_in[i], view.weights_in[i], view.reserves_out[i], view.weights_out[i], view.fees[i],
+                                  kinds[i], inverse_kinds[i], weight_ratios[i], inverse_ratios[i]);
+        }
+
+    private:
+        // first failed check of a mapped file, `nullptr` when the header and layout are valid
+        static const char* validate( const unsigned char* data, const uint64_t bytes )
+        {
+            const snapshot_header& header = *reinterpret_cast<const snapshot_header*>(data);
+            if ( std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ) return "SX.Balancer: SNAPSHOT_MAGIC";
+            if ( header.version != SNAPSHOT_VERSION ) return "SX.Balancer: SNAPSHOT_VERSION";
+            if ( header.endian != SNAPSHOT_ENDIAN ) return "SX.Balancer: SNAPSHOT_ENDIAN";
+            if ( header.size > bytes ) return "SX.Balancer: SNAPSHOT_CORRUPT";
+            uint64_t offsets[snapshot_header::COLUMNS];
+            if ( detail::snapshot_layout(header.size, offsets) != header.bytes || header.bytes != bytes ) return "SX.Balancer: SNAPSHOT_CORRUPT";
+            if ( std::memcmp(offsets, header.offsets, sizeof(offsets)) != 0 ) return "SX.Balancer: SNAPSHOT_CORRUPT";
+
+            // cached weight terms match the weights
+            const uint64_t* weights_in = reinterpret_cast<const uint64_t*>(data + offsets[snapshot_header::weights_in]);
+            const uint64_t* weights_out = reinterpret_cast<const uint64_t*>(data + offsets[snapshot_header::weights_out]);
+            const uint8_t* kinds = data + offsets[snapshot_header::kinds];
+            const uint8_t* inverse_kinds = data + offsets[snapshot_header::inverse_kinds];
+            const double* weight_ratios = reinterpret_cast<const double*>(data + offsets[snapshot_header::weight_ratios]);
+            const double* inverse_ratios = reinterpret_cast<const double*>(data + offsets[snapshot_header::inverse_ratios]);
+            for ( uint64_t i = 0; i < header.size; ++i ) {
+                const uint64_t weight_in = weights_in[i];
+                const uint64_t weight_out = weights_out[i];
+                if ( weight_in == 0 || weight_out == 0 ) return "SX.Balancer: SNAPSHOT_CORRUPT";
+                if ( kinds[i] != static_cast<uint8_t>(get_curve_kind(weight_in, weight_out)) ||
+                     inverse_kinds[i] != static_cast<uint8_t>(get_curve_kind(weight_out, weight_in)) ) return "SX.Balancer: SNAPSHOT_CACHE";
+                if ( detail::to_bits(weight_ratios[i]) != detail::to_bits(static_cast<double>(weight_in) / weight_out) ||
+                     detail::to_bits(inverse_ratios[i]) != detail::to_bits(static_cast<double>(weight_out) / weight_in) ) return "SX.Balancer: SNAPSHOT_CACHE";
+            }
+            return nullptr;
+        }
+
+        template <typename T>
+        const T* column( const snapshot_header::column c ) const
+        {
+            return reinterpret_cast<const T*>(data + reinterpret_cast<const snapshot_header*>(data)->offsets[c]);
+        }
+
+        const unsigned char* data;
+        uint64_t bytes;
+        snapshot view;
+        const curve_kind* kinds;
+        const curve_kind* inverse_kinds;
+        const double* weight_ratios;
+        const double* inverse_ratios;
+    };
+
+    /**
+     * Pool between two tokens of a `route_graph`, reserves and weights on the `token_a` / `token_b` side
+     */
+    struct route_pair {
+        uint32_t token_a;
+        uint32_t token_b;
+        uint64_t reserve_a;
+        uint64_t weight_a;
+        uint64_t reserve_b;
+        uint64_t weight_b;
+        uint8_t fee;
+    };
+
+    static constexpr size_t MAX_ROUTE_HOPS = 4;
+
+    /**
+     * Best route found by `route_graph::best_route`, `hops = 0` when `to` is unreachable
+     */
+    struct route {
+        size_t hops;
+        uint64_t amount_out;
+        uint32_t tokens[MAX_ROUTE_HOPS + 1];        // from, ..., to
+        uint32_t edges[MAX_ROUTE_HOPS];             // directed edge of every hop (see `route_graph::edge`)
+    };
+
+    /**
+     * ## STRUCT `route_graph`
+     *
+     * Token / pool adjacency in compressed sparse row layout, every pair stored as two directed edges
+     *
+     * Edges of a token are contiguous (`offsets[token]` to `offsets[token + 1]`) and their curves live in structure-of-arrays
+     * columns, so a search sweeps one token's edges with `get_amount_out_soa` (every hop equals `get_amount_out`, deep
+     * reserves included). Every buffer, including the search scratch, is allocated once at construction: `best_route` and
+     * `update_pair` never touch the heap
+     *
+     * `best_route` keeps the best amount reaching every token after each hop (the curve is monotonic in `amount_in`, so
+     * the best `k`-hop amount only extends the best `k - 1`-hop amount), up to `max_hops`. Hops are evaluated independently
+     * against current reserves and walks may revisit a pair, so across mispriced pairs a longer route can cycle through an
+     * arbitrage (bound `max_hops` or inspect `route.edges`)
+     *
+     * ### params
+     *
+     * - `{size_t} tokens` - number of tokens (ids `0` to `tokens - 1`)
+     * - `{const route_pair*} pairs` - pools
+     * - `{size_t} count` - number of pools
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const balancer::route_pair pairs[] = {
+     *     { 0, 1, 100000000, 50, 400000000, 50, 30 },
+     *     { 1, 2, 833515447, 20, 10395237882, 80, 30 },
+     *     { 0, 2, 1000000, 50, 10000000, 50, 30 },
+     * };
+     * balancer::route_graph graph( 3, pairs, 3 );
+     *
+     * // Calculation
+     * const balancer::route route = graph.best_route( 0, 2, 10000 );
+     * // => { hops: 2, amount_out: 123952, tokens: [ 0, 1, 2 ] }
+     * ```
+     */
+    class route_graph {
+    public:
+        route_graph( const size_t tokens, const route_pair* pairs, const size_t count )
+            : offsets( tokens + 1, 0 ),
+              sources( 2 * count ),
+              targets( 2 * count ),
+              pair_edges( 2 * count ),
+              edge_pairs( 2 * count ),
+              reserves_in( 2 * count ),
+              weights_in( 2 * count ),
+              reserves_out( 2 * count ),
+              weights_out( 2 * count ),
+              fees( 2 * count ),
+              amounts( (MAX_ROUTE_HOPS + 1) * tokens, 0 ),
+              via( (MAX_ROUTE_HOPS + 1) * tokens ),
+              frontier( (MAX_ROUTE_HOPS + 1) * tokens ),
+              frontier_sizes( MAX_ROUTE_HOPS + 1 )
+        {
+            // checks
+            for ( size_t p = 0; p < count; ++p ) {
+                eosio::check(pairs[p].token_a < tokens && pairs[p].token_b < tokens && pairs[p].token_a != pairs[p].token_b, "SX.Balancer: INVALID_TOKEN");
+                eosio::check(pairs[p].reserve_a > 0 && pairs[p].reserve_b > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+                eosio::check(pairs[p].weight_a > 0 && pairs[p].weight_b > 0, "SX.Balancer: INVALID_WEIGHT");
+            }
+
+            // counting sort of both directions by source token
+            for ( size_t p = 0; p < count; ++p ) {
+                ++offsets[pairs[p].token_a + 1];
+                ++offsets[pairs[p].token_b + 1];
+            }
+            size_t degree = 0;
+            for ( size_t t = 0; t < tokens; ++t ) {
+                degree = std::max<size_t>(degree, offsets[t + 1]);
+                offsets[t + 1] += offsets[t];
+            }
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            for ( size_t p = 0; p < count; ++p ) {
+                const route_pair& pair = pairs[p];
+                pair_edges[2 * p] = add_edge(cursor[pair.token_a]++, pair.token_a, pair.token_b, pair.reserve_a, pair.weight_a, pair.reserve_b, pair.weight_b, pair.fee);
+                pair_edges[2 * p + 1] = add_edge(cursor[pair.token_b]++, pair.token_b, pair.token_a, pair.reserve_b, pair.weight_b, pair.reserve_a, pair.weight_a, pair.fee);
+                edge_pairs[pair_edges[2 * p]] = p;
+                edge_pairs[pair_edges[2 * p + 1]] = p;
+            }
+            scratch_in.resize(degree);
+            scratch_out.resize(degree);
+        }
+
+        /**
+         * Number of tokens
+         */
+        size_t token_count() const
+        {
+            return offsets.size() - 1;
+        }
+
+        /**
+         * Number of directed edges (two per pair)
+         */
+        size_t edge_count() const
+        {
+            return targets.size();
+        }
+
+        /**
+         * Directed edges `offsets[token]` to `offsets[token + 1]` leaving `token`
+         */
+        size_t edges_begin( const uint32_t token ) const { return offsets[token]; }
+        size_t edges_end( const uint32_t token ) const { return offsets[token + 1]; }
+        uint32_t source( const size_t edge ) const { return sources[edge]; }
+        uint32_t target( const size_t edge ) const { return targets[edge]; }
+        size_t pair_of( const size_t edge ) const { return edge_pairs[edge]; }
+
+        /**
+         * Precomputed pool of a directed edge (see `pool`)
+         */
+        pool edge( const size_t edge ) const
+        {
+            return pool(reserves_in[edge], weights_in[edge], reserves_out[edge], weights_out[edge], fees[edge]);
+        }
+
+        /**
+         * Every directed edge as a `snapshot`, in CSR order (see `quote_engine`), valid until the graph is destroyed
+         */
+        snapshot view() const
+        {
+            const snapshot edges = { targets.size(), reserves_in.data(), weights_in.data(), reserves_out.data(), weights_out.data(), fees.data() };
+            return edges;
+        }
+
+        /**
+         * New reserves of pair `pair` (index into the construction `pairs`), both directions
+         */
+        void update_pair( const size_t pair, const uint64_t reserve_a, const uint64_t reserve_b )
+        {
+            eosio::check(2 * pair < pair_edges.size(), "SX.Balancer: INVALID_PAIR");
+            eosio::check(reserve_a > 0 && reserve_b > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+
+            const uint32_t forward = pair_edges[2 * pair];
+            const uint32_t backward = pair_edges[2 * pair + 1];
+            reserves_in[forward] = reserve_a;
+            reserves_out[forward] = reserve_b;
+            reserves_in[backward] = reserve_b;
+            reserves_out[backward] = reserve_a;
+        }
+
+        /**
+         * Apply a trade along directed edge `edge` to the reserves of its pair (see `pool::apply_swap`), returns the pair
+         */
+        size_t apply_swap( const size_t edge, const uint64_t amount_in, const uint64_t amount_out )
+        {
+            eosio::check(edge < targets.size(), "SX.Balancer: INVALID_EDGE");
+            eosio::check(amount_out < reserves_out[edge], "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+
+            const size_t pair = edge_pairs[edge];
+            const uint32_t mirror = pair_edges[2 * pair] == edge ? pair_edges[2 * pair + 1] : pair_edges[2 * pair];
+            const uint64_t reserve_in = safemath::add(reserves_in[edge], amount_in);
+            const uint64_t reserve_out = reserves_out[edge] - amount_out;
+            reserves_in[edge] = reserve_in;
+            reserves_out[edge] = reserve_out;
+            reserves_in[mirror] = reserve_out;
+            reserves_out[mirror] = reserve_in;
+            return pair;
+        }
+
+        /**
+         * Output amount of `amount_in` along the hops of `route` against current reserves (same kernel as `best_route`)
+         */
+        template <typename Check = checked>
+        uint64_t amount_out( const route& route, const uint64_t amount_in ) const
+        {
+            Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            Check::check(route.hops <= MAX_ROUTE_HOPS, "SX.Balancer: INVALID_HOPS");
+
+            uint64_t amount = amount_in;
+            for ( size_t k = 0; k < route.hops && amount > 0; ++k ) {
+                const size_t e = route.edges[k];
+                Check::check(e < targets.size(), "SX.Balancer: INVALID_EDGE");
+                get_amount_out_soa<unchecked>(&amount, &amount, 1, &reserves_in[e], &weights_in[e], &reserves_out[e], &weights_out[e], &fees[e]);
+            }
+            return amount;
+        }
+
+        /**
+         * Route from `from` to `to` of at most `max_hops` hops with the maximum output amount for `amount_in`
+         */
+        template <typename Check = checked>
+        route best_route( const uint32_t from, const uint32_t to, const uint64_t amount_in, const size_t max_hops = MAX_ROUTE_HOPS )
+        {
+            // checks
+            Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            Check::check(from < token_count() && to < token_count(), "SX.Balancer: INVALID_TOKEN");
+            Check::check(max_hops > 0 && max_hops <= MAX_ROUTE_HOPS, "SX.Balancer: INVALID_HOPS");
+
+            const size_t tokens = token_count();
+            amounts[from] = amount_in;
+            frontier[0] = from;
+            frontier_sizes[0] = 1;
+
+            // layer `k + 1` from the best amounts of layer `k`
+            route best = {};
+            for ( size_t k = 0; k < max_hops; ++k ) {
+                uint64_t* next = amounts.data() + (k + 1) * tokens;
+                uint32_t* next_via = via.data() + (k + 1) * tokens;
+                uint32_t* next_frontier = frontier.data() + (k + 1) * tokens;
+                size_t next_size = 0;
+
+                for ( size_t f = 0; f < frontier_sizes[k]; ++f ) {
+                    const uint32_t token = frontier[k * tokens + f];
+                    const uint64_t amount = amounts[k * tokens + token];
+                    const size_t begin = offsets[token];
+                    const size_t n = offsets[token + 1] - begin;
+
+                    std::fill(scratch_in.begin(), scratch_in.begin() + n, amount);
+                    get_amount_out_soa<unchecked>(scratch_in.data(), scratch_out.data(), n, &reserves_in[begin], &weights_in[begin], &reserves_out[begin], &weights_out[begin], &fees[begin]);
+
+                    for ( size_t j = 0; j < n; ++j ) {
+                        const uint32_t target = targets[begin + j];
+                        if ( scratch_out[j] <= next[target] ) continue;
+                        if ( next[target] == 0 ) next_frontier[next_size++] = target;
+                        next[target] = scratch_out[j];
+                        next_via[target] = begin + j;
+                    }
+                }
+                frontier_sizes[k + 1] = next_size;
+                if ( next[to] > best.amount_out ) {
+                    best.amount_out = next[to];
+                    best.hops = k + 1;
+                }
+            }
+
+            // walk back the best layer
+            uint32_t token = to;
+            for ( size_t k = best.hops; k > 0; --k ) {
+                const uint32_t edge = via[k * tokens + token];
+                best.tokens[k] = token;
+                best.edges[k - 1] = edge;
+                token = sources[edge];
+            }
+            best.tokens[0] = from;
+
+            // reset touched scratch
+            for ( size_t k = 0; k <= max_hops; ++k ) {
+                for ( size_t f = 0; f < frontier_sizes[k]; ++f ) amounts[k * tokens + frontier[k * tokens + f]] = 0;
+                frontier_sizes[k] = 0;
+            }
+            return best;
+        }
+
+    private:
+        uint32_t add_edge( const uint32_t edge, const uint32_t from, const uint32_t to, const uint64_t reserve_in, const uint64_t weight_in, const uint64_t reserve_out, const uint64_t weight_out, const uint8_t fee )
+        {
+            sources[edge] = from;
+            targets[edge] = to;
+            reserves_in[edge] = reserve_in;
+            weights_in[edge] = weight_in;
+            reserves_out[edge] = reserve_out;
+            weights_out[edge] = weight_out;
+            fees[edge] = fee;
+            return edge;
+        }
+
+        std::vector<uint32_t> offsets;              // CSR row offsets, `tokens + 1`
+        std::vector<uint32_t> sources;
+        std::vector<uint32_t> targets;
+        std::vector<uint32_t> pair_edges;           // forward / backward edge of every pair
+        std::vector<uint32_t> edge_pairs;           // pair of every edge
+        std::vector<uint64_t> reserves_in;
+        std::vector<uint64_t> weights_in;
+        std::vector<uint64_t> reserves_out;
+        std::vector<uint64_t> weights_out;
+        std::vector<uint8_t> fees;
+
+        // search scratch, `(MAX_ROUTE_HOPS + 1) * tokens` per layer array
+        std::vector<uint64_t> amounts;              // best amount per layer and token, `0` unreached
+        std::vector<uint32_t> via;                  // edge reaching the token in that layer
+        std::vector<uint32_t> frontier;             // tokens reached per layer
+        std::vector<size_t> frontier_sizes;
+        std::vector<uint64_t> scratch_in;           // one token's edges, maximum degree
+        std::vector<uint64_t> scratch_out;
+    };
+
+    /**
+     * ## STRUCT `quote_stream`
+     *
+     * Cached route quotes over a `route_graph`, recomputed only when a pair they trade through changes
+     *
+     * Every subscription registers itself against the pairs of its hops; `apply_swap` / `update_pair` marks only the
+     * dependent quotes stale and `quote` recomputes a stale one on first read, so requote cost follows the number of changed
+     * pairs and read quotes instead of the size of the market. Quotes are `route_graph::amount_out`, every hop equal to
+     * `get_amount_out`. Paths are fixed at `subscribe` (re-run `best_route` to re-select them). Reserve updates must go
+     * through the stream to keep the cache coherent
+     *
+     * ### params
+     *
+     * - `{route_graph&} graph` - pools, updated in place
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs (pairs of `route_graph`)
+     * balancer::route_graph graph( 3, pairs, 3 );
+     * balancer::quote_stream stream( graph );
+     * const balancer::route route = graph.best_route( 0, 2, 10000 );
+     * const size_t id = stream.subscribe( route, 10000 );
+     * // => stream.quote( id ) = 123952
+     *
+     * // new block, a trade on the first hop pair
+     * stream.apply_swap( route.edges[0], 500000, 1984109 );
+     * const uint64_t amount_out = stream.quote( id );
+     * // => 122721 (recomputed once, quotes of untouched pairs stay cached)
+     * ```
+     */
+    class quote_stream {
+    public:
+        explicit quote_stream( route_graph& graph )
+            : graph( graph ),
+              dependents( graph.edge_count() / 2 ),
+              evaluated( 0 )
+        {
+        }
+
+        quote_stream( const quote_stream& ) = delete;
+        quote_stream& operator=( const quote_stream& ) = delete;
+
+        /**
+         * Track the output of `amount_in` along `route`, returns the subscription id
+         */
+        size_t subscribe( const route& route, const uint64_t amount_in )
+        {
+            eosio::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            eosio::check(route.hops > 0 && route.hops <= MAX_ROUTE_HOPS, "SX.Balancer: INVALID_HOPS");
+
+            const size_t id = routes.size();
+            for ( size_t k = 0; k < route.hops; ++k ) {
+                eosio::check(route.edges[k] < graph.edge_count(), "SX.Balancer: INVALID_EDGE");
+                std::vector<size_t>& list = dependents[graph.pair_of(route.edges[k])];
+                if ( list.empty() || list.back() != id ) list.push_back(id);
+            }
+            routes.push_back(route);
+            amounts_in.push_back(amount_in);
+            amounts_out.push_back(0);
+            stale.push_back(1);
+            return id;
+        }
+
+        /**
+         * Number of subscriptions
+         */
+        size_t size() const
+        {
+            return routes.size();
+        }
+
+        /**
+         * Apply a trade along directed edge `edge` (see `route_graph::apply_swap`), dependent quotes become stale
+         */
+        void apply_swap( const size_t edge, const uint64_t amount_in, const uint64_t amount_out )
+        {
+            invalidate(graph.apply_swap(edge, amount_in, amount_out));
+        }
+
+        /**
+         * New reserves of pair `pair` (see `route_graph::update_pair`), dependent quotes become stale
+         */
+        void update_pair( const size_t pair, const uint64_t reserve_a, const uint64_t reserve_b )
+        {
+            graph.update_pair(pair, reserve_a, reserve_b);
+            invalidate(pair);
+        }
+
+        /**
+         * Current output amount of subscription `id`, recomputed only when stale
+         */
+        uint64_t quote( const size_t id )
+        {
+            eosio::check(id < routes.size(), "SX.Balancer: INVALID_SUBSCRIPTION");
+            if ( stale[id] ) {
+                amounts_out[id] = graph.amount_out<unchecked>(routes[id], amounts_in[id]);
+                stale[id] = 0;
+                ++evaluated;
+            }
+            return amounts_out[id];
+        }
+
+        /**
+         * Whether subscription `id` changed since its last `quote`
+         */
+        bool is_stale( const size_t id ) const
+        {
+            return stale[id] != 0;
+        }
+
+        /**
+         * Route evaluations since construction
+         */
+        uint64_t evaluations() const
+        {
+            return evaluated;
+        }
+
+    private:
+        void invalidate( const size_t pair )
+        {
+            for ( const size_t id : dependents[pair] ) stale[id] = 1;
+        }
+
+        route_graph& graph;
+        std::vector<std::vector<size_t>> dependents;    // subscriptions trading through every pair
+        std::vector<route> routes;
+        std::vector<uint64_t> amounts_in;
+        std::vector<uint64_t> amounts_out;              // cached quotes
+        std::vector<uint8_t> stale;
+        uint64_t evaluated;
+    };
+}
@@ -2,8 +2,668 @@
 
 #include <sx.safemath/safemath.hpp>
 #include <math.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#if defined(BALANCER_INSTRUMENTATION)
+#include <atomic>
+#define BALANCER_COUNT(name) ::balancer::instrumentation::record(::balancer::instrumentation::counter::name)
+#else
+#define BALANCER_COUNT(name) ((void) 0)
+#endif
 
 namespace balancer {
+    typedef unsigned __int128 uint128;
+
+#if defined(BALANCER_INSTRUMENTATION)
+    /**
+     * ## Instrumentation
+     *
+     * Opt-in hot-path counters, compiled out unless `BALANCER_INSTRUMENTATION` is defined (host builds, counters are
+     * relaxed atomics shared by every translation unit)
+     *
+     * - `get_amount_out`, `get_amount_in`, `quote`, `get_amount_out_with_fees` - calls per function
+     * - `closed_form` / `generic` - curve dispatch of `get_amount_out` / `get_amount_in` / `get_amount_out_with_fees` (closed-form fast path vs `pow`)
+     * - `wide_math` - 64-bit fast path overflowed into 128-bit arithmetic (overflow guard)
+     * - `check_failure` - failed `checked` policy checks
+     *
+     * A hook registered with `set_hook( hook, period )` is called with the counter and its new value every `period` events
+     *
+     * ### example
+     *
+     * ```c++
+     * // g++ -DBALANCER_INSTRUMENTATION ...
+     * balancer::get_amount_out( 10000, 45851931234, 50000, 125682033533, 50000 );
+     * const uint64_t hits = balancer::instrumentation::get( balancer::instrumentation::counter::closed_form );
+     * // => 1
+     * ```
+     */
+    namespace instrumentation {
+        enum class counter : uint8_t {
+            get_amount_out,
+            get_amount_in,
+            quote,
+            get_amount_out_with_fees,
+            closed_form,
+            generic,
+            wide_math,
+            check_failure
+        };
+
+        static constexpr size_t COUNTERS = 8;
+
+        typedef void (*hook)( counter name, uint64_t value );
+
+        struct state {
+            std::atomic<uint64_t> values[COUNTERS];
+            std::atomic<hook> callback;
+            std::atomic<uint64_t> period;
+        };
+
+        inline state& global()
+        {
+            static state instance;
+            return instance;
+        }
+
+        inline void record( const counter name )
+        {
+            state& s = global();
+            const uint64_t value = s.values[static_cast<size_t>(name)].fetch_add(1, std::memory_order_relaxed) + 1;
+            const hook callback = s.callback.load(std::memory_order_relaxed);
+            if ( !callback ) return;
+            const uint64_t period = s.period.load(std::memory_order_relaxed);
+            if ( period && value % period == 0 ) callback(name, value);
+        }
+
+        inline uint64_t get( const counter name )
+        {
+            return global().values[static_cast<size_t>(name)].load(std::memory_order_relaxed);
+        }
+
+        inline void reset()
+        {
+            for ( size_t i = 0; i < COUNTERS; ++i ) global().values[i].store(0, std::memory_order_relaxed);
+        }
+
+        inline void set_hook( const hook callback, const uint64_t period = 1 )
+        {
+            global().period.store(period ? period : 1, std::memory_order_relaxed);
+            global().callback.store(callback, std::memory_order_relaxed);
+        }
+    }
+#endif
+
+    /**
+     * ## Check policies
+     *
+     * Template parameter of the curve functions selecting how inputs and overflows are validated
+     *
+     * - `checked` - (default) `eosio::check`, usable in constant evaluation (a failure is then a compile error)
+     * - `unchecked` - no validation, for inputs validated once (e.g. at `pool` construction)
+     * - `debug_assert` - `assert`, compiled out with `NDEBUG`
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t amount_out = balancer::get_amount_out<balancer::unchecked>( 10000, 45851931234, 50000, 125682033533, 50000 );
+     * // => 27328
+     * ```
+     */
+    struct checked {
+        static constexpr void check( const bool pred, const char* message )
+        {
+            if ( !pred ) {
+                BALANCER_COUNT(check_failure);
+                eosio::check(false, message);
+            }
+        }
+    };
+
+    struct unchecked {
+        static constexpr void check( const bool, const char* ) {}
+    };
+
+    struct debug_assert {
+        static void check( const bool pred, const char* message )
+        {
+            assert(pred && message);
+            (void) pred;
+            (void) message;
+        }
+    };
+
+    namespace detail {
+        // fdlibm `log` / `exp` coefficients, shared by the scalar and vector kernels
+        static const double LN2_HI = 6.93147180369123816490e-01;
+        static const double LN2_LO = 1.90821492927058770002e-10;
+        static const double INV_LN2 = 1.44269504088896338700e+00;
+        static const double SQRT2 = 1.41421356237309514547e+00;
+        static const double ROUND = 6755399441055744.0;    // 1.5 * 2^52
+        static const double EXP_MIN = -708.0;
+        static const double EXP_MAX = 709.0;
+        static const double LG1 = 6.666666666666735130e-01;
+        static const double LG2 = 3.999999999940941908e-01;
+        static const double LG3 = 2.857142874366239149e-01;
+        static const double LG4 = 2.222219843214978396e-01;
+        static const double LG5 = 1.818357216161805012e-01;
+        static const double LG6 = 1.531383769920937332e-01;
+        static const double LG7 = 1.479819860511658591e-01;
+        static const double P1 = 1.66666666666666019037e-01;
+        static const double P2 = -2.77777777770155933842e-03;
+        static const double P3 = 6.61375632143793436117e-05;
+        static const double P4 = -1.65339022054652515390e-06;
+        static const double P5 = 4.13813679705723846039e-08;
+
+        static inline uint64_t to_bits( const double x ) { uint64_t u; memcpy(&u, &x, sizeof(u)); return u; }
+        static inline double from_bits( const uint64_t u ) { double x; memcpy(&x, &u, sizeof(x)); return x; }
+
+        /**
+         * natural log of a positive normal `x`, same operation order as the vector lanes
+         */
+        static inline double log_kernel( const double x )
+        {
+            const uint64_t bits = to_bits(x);
+            double m = from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+            double k = from_bits((bits >> 52) | 0x4330000000000000ULL) - 4503599627371519.0; // - (2^52 + 1023)
+            if ( m > SQRT2 ) { m = m * 0.5; k = k + 1.0; }
+
+            const double f = m - 1.0;
+            const double s = f / (2.0 + f);
+            const double z = s * s;
+            const double w = z * z;
+            const double t1 = w * (LG2 + w * (LG4 + w * LG6));
+            const double t2 = z * (LG1 + w * (LG3 + w * (LG5 + w * LG7)));
+            const double r = t2 + t1;
+            const double hfsq = 0.5 * f * f;
+            return k * LN2_HI - ((hfsq - (s * (hfsq + r) + k * LN2_LO)) - f);
+        }
+
+        /**
+         * `e^x`, flushes to zero below `EXP_MIN`, same operation order as the vector lanes
+         */
+        static inline double exp_kernel( const double x )
+        {
+            const double xc = x < EXP_MIN ? EXP_MIN : (x > EXP_MAX ? EXP_MAX : x);
+            const double kr = xc * INV_LN2 + ROUND;
+            const double k = kr - ROUND;
+            const double hi = xc - k * LN2_HI;
+            const double lo = k * LN2_LO;
+            const double r = hi - lo;
+            const double t = r * r;
+            const double c = r - t * (P1 + t * (P2 + t * (P3 + t * (P4 + t * P5))));
+            const double y = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+            const double scale = from_bits((to_bits(kr) + 1023) << 52);
+            return x < EXP_MIN ? 0.0 : y * scale;
+        }
+
+#if defined(__AVX2__)
+        static inline __m256d log_kernel( const __m256d x )
+        {
+            const __m256i bits = _mm256_castpd_si256(x);
+            __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffLL)), _mm256_set1_epi64x(0x3ff0000000000000LL)));
+            __m256d k = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(0x4330000000000000LL))), _mm256_set1_pd(4503599627371519.0));
+            const __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(SQRT2), _CMP_GT_OQ);
+            m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+            k = _mm256_blendv_pd(k, _mm256_add_pd(k, _mm256_set1_pd(1.0)), big);
+
+            const __m256d f = _mm256_sub_pd(m, _mm256_set1_pd(1.0));
+            const __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+            const __m256d z = _mm256_mul_pd(s, s);
+            const __m256d w = _mm256_mul_pd(z, z);
+            const __m256d t1 = _mm256_mul_pd(w, _mm256_add_pd(_mm256_set1_pd(LG2), _mm256_mul_pd(w, _mm256_add_pd(_mm256_set1_pd(LG4), _mm256_mul_pd(w, _mm256_set1_pd(LG6))))));
+            const __m256d t2 = _mm256_mul_pd(z, _mm256_add_pd(_mm256_set1_pd(LG1), _mm256_mul_pd(w, _mm256_add_pd(_mm256_set1_pd(LG3), _mm256_mul_pd(w, _mm256_add_pd(_mm256_set1_pd(LG5), _mm256_mul_pd(w, _mm256_set1_pd(LG7))))))));
+            const __m256d r = _mm256_add_pd(t2, t1);
+            const __m256d hfsq = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), f), f);
+            const __m256d inner = _mm256_add_pd(_mm256_mul_pd(s, _mm256_add_pd(hfsq, r)), _mm256_mul_pd(k, _mm256_set1_pd(LN2_LO)));
+            return _mm256_sub_pd(_mm256_mul_pd(k, _mm256_set1_pd(LN2_HI)), _mm256_sub_pd(_mm256_sub_pd(hfsq, inner), f));
+        }
+
+        static inline __m256d exp_kernel( const __m256d x )
+        {
+            const __m256d xc = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(EXP_MIN)), _mm256_set1_pd(EXP_MAX));
+            const __m256d kr = _mm256_add_pd(_mm256_mul_pd(xc, _mm256_set1_pd(INV_LN2)), _mm256_set1_pd(ROUND));
+            const __m256d k = _mm256_sub_pd(kr, _mm256_set1_pd(ROUND));
+            const __m256d hi = _mm256_sub_pd(xc, _mm256_mul_pd(k, _mm256_set1_pd(LN2_HI)));
+            const __m256d lo = _mm256_mul_pd(k, _mm256_set1_pd(LN2_LO));
+            const __m256d r = _mm256_sub_pd(hi, lo);
+            const __m256d t = _mm256_mul_pd(r, r);
+            __m256d p = _mm256_add_pd(_mm256_set1_pd(P4), _mm256_mul_pd(t, _mm256_set1_pd(P5)));
+            p = _mm256_add_pd(_mm256_set1_pd(P3), _mm256_mul_pd(t, p));
+            p = _mm256_add_pd(_mm256_set1_pd(P2), _mm256_mul_pd(t, p));
+            p = _mm256_add_pd(_mm256_set1_pd(P1), _mm256_mul_pd(t, p));
+            const __m256d c = _mm256_sub_pd(r, _mm256_mul_pd(t, p));
+            const __m256d q = _mm256_div_pd(_mm256_mul_pd(r, c), _mm256_sub_pd(_mm256_set1_pd(2.0), c));
+            const __m256d y = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_sub_pd(_mm256_sub_pd(lo, q), hi));
+            const __m256d scale = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(_mm256_castpd_si256(kr), _mm256_set1_epi64x(1023)), 52));
+            const __m256d flush = _mm256_cmp_pd(x, _mm256_set1_pd(EXP_MIN), _CMP_NLT_UQ);
+            return _mm256_and_pd(_mm256_mul_pd(y, scale), flush);
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        static inline float64x2_t log_kernel( const float64x2_t x )
+        {
+            const uint64x2_t bits = vreinterpretq_u64_f64(x);
+            float64x2_t m = vreinterpretq_f64_u64(vorrq_u64(vandq_u64(bits, vdupq_n_u64(0x000fffffffffffffULL)), vdupq_n_u64(0x3ff0000000000000ULL)));
+            float64x2_t k = vsubq_f64(vreinterpretq_f64_u64(vorrq_u64(vshrq_n_u64(bits, 52), vdupq_n_u64(0x4330000000000000ULL))), vdupq_n_f64(4503599627371519.0));
+            const uint64x2_t big = vcgtq_f64(m, vdupq_n_f64(SQRT2));
+            m = vbslq_f64(big, vmulq_f64(m, vdupq_n_f64(0.5)), m);
+            k = vbslq_f64(big, vaddq_f64(k, vdupq_n_f64(1.0)), k);
+
+            const float64x2_t f = vsubq_f64(m, vdupq_n_f64(1.0));
+            const float64x2_t s = vdivq_f64(f, vaddq_f64(vdupq_n_f64(2.0), f));
+            const float64x2_t z = vmulq_f64(s, s);
+            const float64x2_t w = vmulq_f64(z, z);
+            const float64x2_t t1 = vmulq_f64(w, vaddq_f64(vdupq_n_f64(LG2), vmulq_f64(w, vaddq_f64(vdupq_n_f64(LG4), vmulq_f64(w, vdupq_n_f64(LG6))))));
+            const float64x2_t t2 = vmulq_f64(z, vaddq_f64(vdupq_n_f64(LG1), vmulq_f64(w, vaddq_f64(vdupq_n_f64(LG3), vmulq_f64(w, vaddq_f64(vdupq_n_f64(LG5), vmulq_f64(w, vdupq_n_f64(LG7))))))));
+            const float64x2_t r = vaddq_f64(t2, t1);
+            const float64x2_t hfsq = vmulq_f64(vmulq_f64(vdupq_n_f64(0.5), f), f);
+            const float64x2_t inner = vaddq_f64(vmulq_f64(s, vaddq_f64(hfsq, r)), vmulq_f64(k, vdupq_n_f64(LN2_LO)));
+            return vsubq_f64(vmulq_f64(k, vdupq_n_f64(LN2_HI)), vsubq_f64(vsubq_f64(hfsq, inner), f));
+        }
+
+        static inline float64x2_t exp_kernel( const float64x2_t x )
+        {
+            const float64x2_t xc = vminq_f64(vmaxq_f64(x, vdupq_n_f64(EXP_MIN)), vdupq_n_f64(EXP_MAX));
+            const float64x2_t kr = vaddq_f64(vmulq_f64(xc, vdupq_n_f64(INV_LN2)), vdupq_n_f64(ROUND));
+            const float64x2_t k = vsubq_f64(kr, vdupq_n_f64(ROUND));
+            const float64x2_t hi = vsubq_f64(xc, vmulq_f64(k, vdupq_n_f64(LN2_HI)));
+            const float64x2_t lo = vmulq_f64(k, vdupq_n_f64(LN2_LO));
+            const float64x2_t r = vsubq_f64(hi, lo);
+            const float64x2_t t = vmulq_f64(r, r);
+            float64x2_t p = vaddq_f64(vdupq_n_f64(P4), vmulq_f64(t, vdupq_n_f64(P5)));
+            p = vaddq_f64(vdupq_n_f64(P3), vmulq_f64(t, p));
+            p = vaddq_f64(vdupq_n_f64(P2), vmulq_f64(t, p));
+            p = vaddq_f64(vdupq_n_f64(P1), vmulq_f64(t, p));
+            const float64x2_t c = vsubq_f64(r, vmulq_f64(t, p));
+            const float64x2_t q = vdivq_f64(vmulq_f64(r, c), vsubq_f64(vdupq_n_f64(2.0), c));
+            const float64x2_t y = vsubq_f64(vdupq_n_f64(1.0), vsubq_f64(vsubq_f64(lo, q), hi));
+            const float64x2_t scale = vreinterpretq_f64_u64(vshlq_n_u64(vaddq_u64(vreinterpretq_u64_f64(kr), vdupq_n_u64(1023)), 52));
+            const uint64x2_t keep = vcgeq_f64(x, vdupq_n_f64(EXP_MIN));
+            return vreinterpretq_f64_u64(vandq_u64(vreinterpretq_u64_f64(vmulq_f64(y, scale)), keep));
+        }
+#endif
+    }
+
+    /**
+     * ## STATIC `pow_batch`
+     *
+     * Element-wise `z[i] = x[i] ^ y[i]`, evaluated as `exp(y * log(x))` with AVX2 (4 lanes) or NEON (2 lanes),
+     * falls back to a scalar kernel using the same polynomials when neither is available
+     *
+     * Inputs are positive normal `x` (weighted curve numerators are in `(0, 1]`), results below `2^-1021` are flushed to zero,
+     * relative error against `pow` is bounded by `(2 + 3 * |y * log(x)|) * 2^-53`, vector lanes match the scalar kernel
+     *
+     * ### params
+     *
+     * - `{const double*} x` - bases
+     * - `{const double*} y` - exponents
+     * - `{double*} z` - results (caller buffer of `count` elements)
+     * - `{size_t} count` - number of elements
+     *
+     * ### example
+     *
+     * ```c++
+     * const double x[] = { 0.25, 0.5 };
+     * const double y[] = { 0.5, 2.0 };
+     * double z[2];
+     * balancer::pow_batch( x, y, z, 2 );
+     * // => [ 0.5, 0.25 ]
+     * ```
+     */
+    static void pow_batch( const double* x, const double* y, double* z, const size_t count )
+    {
+        size_t i = 0;
+#if defined(__AVX2__)
+        for ( ; i + 4 <= count; i += 4 ) {
+            const __m256d lx = detail::log_kernel(_mm256_loadu_pd(x + i));
+            _mm256_storeu_pd(z + i, detail::exp_kernel(_mm256_mul_pd(_mm256_loadu_pd(y + i), lx)));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for ( ; i + 2 <= count; i += 2 ) {
+            const float64x2_t lx = detail::log_kernel(vld1q_f64(x + i));
+            vst1q_f64(z + i, detail::exp_kernel(vmulq_f64(vld1q_f64(y + i), lx)));
+        }
+#endif
+        for ( ; i < count; ++i ) {
+            z[i] = detail::exp_kernel(y[i] * detail::log_kernel(x[i]));
+        }
+    }
+
+    /**
+     * Weight ratios (`reserve_weight_in / reserve_weight_out`) with a closed-form curve
+     */
+    enum class curve_kind : uint8_t {
+        generic,    // pow(x, ratio)
+        pow_1,      // 50/50, constant product
+        pow_2,
+        pow_3,
+        pow_4,      // 80/20
+        root_2,
+        root_3,
+        root_4      // 20/80
+    };
+
+    constexpr bool is_weight_multiple( const uint64_t a, const uint64_t b, const uint64_t k )
+    {
+        return b <= UINT64_MAX / k && a == b * k;
+    }
+
+    /**
+     * ## STATIC `get_curve_kind`
+     *
+     * Classify a weight pair, `curve_kind::generic` when no closed form applies
+     *
+     * ### example
+     *
+     * ```c++
+     * const balancer::curve_kind kind = balancer::get_curve_kind( 20, 80 );
+     * // => curve_kind::root_4
+     * ```
+     */
+    constexpr curve_kind get_curve_kind( const uint64_t reserve_weight_in, const uint64_t reserve_weight_out )
+    {
+        return reserve_weight_in == reserve_weight_out ? curve_kind::pow_1 :
+               is_weight_multiple(reserve_weight_in, reserve_weight_out, 2) ? curve_kind::pow_2 :
+               is_weight_multiple(reserve_weight_in, reserve_weight_out, 3) ? curve_kind::pow_3 :
+               is_weight_multiple(reserve_weight_in, reserve_weight_out, 4) ? curve_kind::pow_4 :
+               is_weight_multiple(reserve_weight_out, reserve_weight_in, 2) ? curve_kind::root_2 :
+               is_weight_multiple(reserve_weight_out, reserve_weight_in, 3) ? curve_kind::root_3 :
+               is_weight_multiple(reserve_weight_out, reserve_weight_in, 4) ? curve_kind::root_4 :
+               curve_kind::generic;
+    }
+
+    /**
+     * Compile-time weight pair, `kind` selects the curve without a runtime ratio check
+     */
+    template <uint64_t W_IN, uint64_t W_OUT>
+    struct weight_ratio {
+        static_assert(W_IN > 0 && W_OUT > 0, "SX.Balancer: INVALID_WEIGHT");
+        static constexpr curve_kind kind = get_curve_kind(W_IN, W_OUT);
+    };
+
+    namespace detail {
+        /**
+         * `1 - x^ratio` factored around `d = 1 - x` (computed by the caller without cancellation)
+         */
+        static inline double curve_decay( const curve_kind kind, const double ratio, const double x, const double d )
+        {
+            switch ( kind ) {
+                case curve_kind::pow_1: return d;
+                case curve_kind::pow_2: return d * (1 + x);
+                case curve_kind::pow_3: return d * (1 + x + x * x);
+                case curve_kind::pow_4: return d * (1 + x) * (1 + x * x);
+                case curve_kind::root_2: return d / (1 + sqrt(x));
+                case curve_kind::root_3: { const double c = cbrt(x); return d / (1 + c + c * c); }
+                case curve_kind::root_4: { const double q = sqrt(sqrt(x)); return d / ((1 + q) * (1 + q * q)); }
+                default: return -expm1(ratio * log1p(-d));
+            }
+        }
+
+        /**
+         * `y^ratio - 1` factored around `e = y - 1` (computed by the caller without cancellation)
+         */
+        static inline double curve_growth( const curve_kind kind, const double ratio, const double e )
+        {
+            const double y = 1 + e;
+            switch ( kind ) {
+                case curve_kind::pow_1: return e;
+                case curve_kind::pow_2: return e * (1 + y);
+                case curve_kind::pow_3: return e * (1 + y + y * y);
+                case curve_kind::pow_4: return e * (1 + y) * (1 + y * y);
+                case curve_kind::root_2: return e / (1 + sqrt(y));
+                case curve_kind::root_3: { const double c = cbrt(y); return e / (1 + c + c * c); }
+                case curve_kind::root_4: { const double q = sqrt(sqrt(y)); return e / ((1 + q) * (1 + q * q)); }
+                default: return expm1(ratio * log1p(e));
+            }
+        }
+
+        /**
+         * Exact integer 50/50 curve `amount_in_with_fee * reserve_out / (reserve_in + amount_in_with_fee)`, `false` when
+         * `amount_in_with_fee` exceeds 64 bits
+         */
+        static inline bool amount_out_equal( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee, uint64_t& amount_out )
+        {
+            // 64-bit fast path when every intermediate fits
+            uint64_t amount64, reserve64, product, sum;
+            if ( !__builtin_mul_overflow(amount_in, 10000 - fee, &amount64) && !__builtin_mul_overflow(reserve_in, 10000, &reserve64) &&
+                 !__builtin_mul_overflow(amount64, reserve_out, &product) && !__builtin_add_overflow(reserve64, amount64, &sum) ) {
+                amount_out = product / sum;
+                return true;
+            }
+            BALANCER_COUNT(wide_math);
+
+            const uint128 amount_in_with_fee = static_cast<uint128>(amount_in) * (10000 - fee);
+            if ( amount_in_with_fee >> 64 ) return false;
+            amount_out = amount_in_with_fee * reserve_out / (static_cast<uint128>(reserve_in) * 10000 + amount_in_with_fee);
+            return true;
+        }
+
+        /**
+         * `reserve_out * (1 - (reserve_in / (reserve_in + amount_in_with_fee)) ^ ratio)` for a closed-form `kind`,
+         * equal weights use exact integer math
+         */
+        static inline uint64_t amount_out_closed_form( const curve_kind kind, const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee )
+        {
+            uint64_t amount_out;
+            if ( kind == curve_kind::pow_1 && amount_out_equal(amount_in, reserve_in, reserve_out, fee, amount_out) ) return amount_out;
+
+            const uint128 amount_in_with_fee = static_cast<uint128>(amount_in) * (10000 - fee);
+            const uint128 reserve_in_scaled = static_cast<uint128>(reserve_in) * 10000;
+            const double sum = static_cast<double>(reserve_in_scaled + amount_in_with_fee);
+            const double x = static_cast<double>(reserve_in_scaled) / sum;
+            const double d = static_cast<double>(amount_in_with_fee) / sum;
+            return reserve_out * curve_decay(kind, 0, x, d);
+        }
+
+        /**
+         * Exact integer 50/50 inverse `reserve_in * amount_out / ((reserve_out - amount_out) * (1 - fee))` rounded up, the
+         * smallest input `amount_out_equal` maps to at least `amount_out`, `false` when `reserve_in * 10000` exceeds 64 bits
+         */
+        static inline bool amount_in_equal( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee, uint64_t& amount_in )
+        {
+            // 64-bit fast path when every intermediate fits
+            uint64_t reserve64, product, remaining64;
+            if ( !__builtin_mul_overflow(reserve_in, 10000, &reserve64) && !__builtin_mul_overflow(reserve64, amount_out, &product) &&
+                 !__builtin_mul_overflow(reserve_out - amount_out, 10000 - fee, &remaining64) ) {
+                amount_in = product / remaining64 + (product % remaining64 != 0);
+                return true;
+            }
+            BALANCER_COUNT(wide_math);
+
+            const uint128 reserve_in_scaled = static_cast<uint128>(reserve_in) * 10000;
+            if ( reserve_in_scaled >> 64 ) return false;
+            const uint128 numerator = reserve_in_scaled * amount_out;
+            const uint128 denominator = static_cast<uint128>(reserve_out - amount_out) * (10000 - fee);
+            amount_in = numerator / denominator + (numerator % denominator != 0);
+            return true;
+        }
+
+        /**
+         * Real inverse `reserve_in * ((reserve_out / (reserve_out - amount_out)) ^ ratio - 1) / (1 - fee)` where `kind` /
+         * `ratio` describe `reserve_weight_out / reserve_weight_in`
+         */
+        static inline double amount_in_real( const curve_kind kind, const double ratio, const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee )
+        {
+            const uint128 reserve_in_scaled = static_cast<uint128>(reserve_in) * 10000;
+            const double e = static_cast<double>(amount_out) / (reserve_out - amount_out);
+            return static_cast<double>(reserve_in_scaled) * curve_growth(kind, ratio, e) / (10000 - fee);
+        }
+
+        /**
+         * `amount_in_real` rounded up, equal weights use exact integer math
+         */
+        static inline uint64_t amount_in_curve( const curve_kind kind, const double ratio, const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee )
+        {
+            uint64_t amount_in;
+            if ( kind == curve_kind::pow_1 && amount_in_equal(amount_out, reserve_in, reserve_out, fee, amount_in) ) return amount_in;
+            return 1 + amount_in_real(kind, ratio, amount_out, reserve_in, reserve_out, fee);
+        }
+
+        /**
+         * `amount_a * weighted_reserve_b / weighted_reserve_a`, stays in 64-bit when the operands fit
+         */
+        template <typename Check>
+        static inline uint64_t quote_weighted( const uint64_t amount_a, const uint128 weighted_reserve_a, const uint128 weighted_reserve_b )
+        {
+            uint64_t product;
+            if ( (weighted_reserve_a >> 64) == 0 && (weighted_reserve_b >> 64) == 0 &&
+                 !__builtin_mul_overflow(amount_a, static_cast<uint64_t>(weighted_reserve_b), &product) ) {
+                return product / static_cast<uint64_t>(weighted_reserve_a);
+            }
+            BALANCER_COUNT(wide_math);
+
+            // 128-bit path, a `weighted_reserve_b` above 64 bits is scaled down with `weighted_reserve_a` (relative error `2^-64`)
+            uint128 numerator = weighted_reserve_b;
+            uint128 denominator = weighted_reserve_a;
+            if ( numerator >> 64 ) {
+                const int shift = 64 - __builtin_clzll(static_cast<uint64_t>(numerator >> 64));
+                numerator >>= shift;
+                denominator >>= shift;
+                if ( denominator == 0 ) denominator = 1;
+            }
+            const uint128 amount_b = static_cast<uint128>(amount_a) * numerator / denominator;
+            Check::check((amount_b >> 64) == 0, "SX.Balancer: OVERFLOW");
+            return amount_b;
+        }
+    }
+
+#if defined(BALANCER_FIXED_POINT)
+    /**
+     * ## On-chain profile
+     *
+     * Defining `BALANCER_FIXED_POINT` makes `get_amount_out` (both overloads) and `get_amount_in` integer-only: equal
+     * weights keep the exact integer curve, every other weight ratio (and 50/50 amounts above 64 bits) is evaluated with
+     * the `BNum` fixed-point `bpow` (see `get_amount_out_fixed` / `get_amount_in_fixed`), so a contract calling them links
+     * no `pow` / softfloat code. Results may differ from the double path within the `bpow` precision (`BPOW_PRECISION`),
+     * trades beyond Balancer's `MAX_IN_RATIO` / `MAX_OUT_RATIO` are rejected, combine with the `unchecked` policy for
+     * inputs validated once
+     *
+     * Host paths (`pool`, `multi_pool`, `curve_table`, `get_amount_out_batch`, `quote_engine`) stay on
+     * the double curve, their "identical to `get_amount_out`" guarantees refer to the double build and hold against the profile
+     * within one unit plus `reserve_out * BPOW_PRECISION / BONE`. `get_amount_in` and `pool.amount_in_exact` verify against the
+     * profile's own `get_amount_out`, so the smallest covering input holds in both builds
+     *
+     * ### example
+     *
+     * ```c++
+     * // cdt-cpp -DBALANCER_FIXED_POINT ...
+     * const uint64_t amount_out = balancer::get_amount_out( 100000, 833515447, 20, 10395237882, 80 );
+     * // => 310830
+     * ```
+     */
+    namespace detail {
+        template <typename Check>
+        static uint64_t amount_out_fixed( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee );
+
+        template <typename Check>
+        static uint64_t amount_in_fixed( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee );
+    }
+#endif
+
+    namespace detail {
+        /**
+         * `get_amount_out` curve for validated inputs, `kind` of `reserve_weight_in / reserve_weight_out` (no counters)
+         */
+        template <typename Check>
+        static inline uint64_t amount_out_weighted( const curve_kind kind, const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint16_t fee )
+        {
+#if defined(BALANCER_FIXED_POINT)
+            uint64_t amount_out;
+            if ( kind == curve_kind::pow_1 && amount_out_equal(amount_in, reserve_in, reserve_out, fee, amount_out) ) return amount_out;
+            return amount_out_fixed<Check>(amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee);
+#else
+            if ( kind != curve_kind::generic ) return amount_out_closed_form(kind, amount_in, reserve_in, reserve_out, fee);
+
+            // 1 - (reserve_in / (reserve_in + amount_in_with_fee)) ^ weight_ratio, without cancellation for small trades
+            const double weight_ratio = (static_cast<double>(reserve_weight_in) / reserve_weight_out);
+            const double reserve_in_scaled = static_cast<double>(reserve_in) * 10000;
+            const double amount_in_with_fee = static_cast<double>(amount_in) * (10000 - fee);
+            const double denominator = -expm1(-weight_ratio * log1p(amount_in_with_fee / reserve_in_scaled));
+            const uint64_t amount_out = reserve_out * denominator;
+
+            return amount_out;
+#endif
+        }
+
+        /**
+         * Smallest input that `covers`, searched from `estimate` by doubling steps (up when short, down while the lower
+         * input still covers) then bisection, `covers` is monotonic and never accepts `0`
+         */
+        template <typename Check, typename Covers>
+        static inline uint64_t smallest_covering( const uint64_t estimate, const Covers& covers )
+        {
+            // bracket (low, high], `low` short (or 0) and `high` covering
+            uint64_t low = estimate;
+            uint64_t high = estimate;
+            if ( high > 0 && covers(high) ) {
+                for ( uint64_t step = 1; low > 0; step <<= 1 ) {
+                    low = high > step ? high - step : 0;
+                    if ( low == 0 || !covers(low) ) break;
+                    high = low;
+                }
+            } else {
+                for ( uint64_t step = 1; high == 0 || !covers(high); step <<= 1 ) {
+                    const bool fits = step != 0 && high <= UINT64_MAX - step;
+                    Check::check(fits, "SX.Balancer: OVERFLOW");
+                    if ( !fits ) return UINT64_MAX;
+                    low = high;
+                    high += step;
+                }
+            }
+            while ( high - low > 1 ) {
+                const uint64_t middle = low + (high - low) / 2;
+                if ( covers(middle) ) high = middle;
+                else low = middle;
+            }
+            return high;
+        }
+
+        /**
+         * Smallest input whose `amount_out_weighted` covers `amount_out`, `kind` / `inverse_kind` of `reserve_weight_in /
+         * reserve_weight_out` and its inverse, `inverse_ratio` of `reserve_weight_out / reserve_weight_in`
+         *
+         * The rounded-up inverse is returned directly: exact integer math for equal weights, `ceil( amount_in_real )` when
+         * the rounding of both curves (`tolerance`, in units of input) cannot reach an integer, otherwise one forward
+         * evaluation at the nearest integer decides. A `tolerance` of a quarter unit or more (inverses from about `2^46`, or
+         * trades draining `reserve_out`) and the `BALANCER_FIXED_POINT` curve (`bpow` precision `1e-10`) cannot resolve a
+         * unit of input, those are searched by `smallest_covering`
+         */
+        template <typename Check>
+        static inline uint64_t amount_in_weighted( const curve_kind kind, const curve_kind inverse_kind, const double inverse_ratio, const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint16_t fee )
+        {
+            const auto covers = [&]( const uint64_t candidate ) {
+                return amount_out_weighted<unchecked>(kind, candidate, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee) >= amount_out;
+            };
+
+            // exact 50/50 inverse while the forward curve stays on 64-bit integers
+            uint64_t amount_in;
+            if ( kind == curve_kind::pow_1 && amount_in_equal(amount_out, reserve_in, reserve_out, fee, amount_in) && amount_in <= UINT64_MAX / (10000 - fee) ) return amount_in;
+
+#if defined(BALANCER_FIXED_POINT)
+            return smallest_covering<Check>(amount_in_fixed<Check>(amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee), covers);
+#else
+            // both curves are within a few ulp, the forward error moves the boundary by `amount_out / slope`
+            const double estimate = amount_in_real(inverse_kind, inverse_ratio, amount_out, reserve_in, reserve_out, fee);
+            const double reserve_in_scaled = static_cast<double>(reserve_in) * 10000;
+            const double reach = amount_out * inverse_ratio * (reserve_in_scaled + estimate * (10000 - fee)) / ((10000 - fee) * static_cast<double>(reserve_out - amount_out));
+            const double tolerance = (estimate + reach) * (16.0 / (1ULL << 52));
+            if ( tolerance < 0.25 ) {
+                const double nearest = floor(estimate + 0.5);
+                if ( fabs(estimate - nearest) > tolerance ) return estimate < 1 ? 1 : static_cast<uint64_t>(ceil(estimate));
+                amount_in = nearest < 1 ? 1 : static_cast<uint64_t>(nearest);
+                return covers(amount_in) ? amount_in : amount_in + 1;
+            }
+            return smallest_covering<Check>(estimate < 18446744073709551615.0 ? static_cast<uint64_t>(estimate) : UINT64_MAX, covers);
+#endif
+        }
+    }
+
     /**
      * ## STATIC `get_amount_out`
      *
@@ -34,31 +694,373 @@ namespace balancer {
      * // => 27328
      * ```
      */
+    template <typename Check = checked>
     static uint64_t get_amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee = 30 )
     {
+        BALANCER_COUNT(get_amount_out);
+
+        // checks
+        Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+        Check::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+
+        // closed-form weight ratios (50/50, 80/20, 20/80, ...)
+        const curve_kind kind = get_curve_kind(reserve_weight_in, reserve_weight_out);
+#if defined(BALANCER_FIXED_POINT)
+        const bool closed_form = kind == curve_kind::pow_1;
+#else
+        const bool closed_form = kind != curve_kind::generic;
+#endif
+        if ( closed_form ) BALANCER_COUNT(closed_form);
+        else BALANCER_COUNT(generic);
+
+        return detail::amount_out_weighted<Check>(kind, amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee);
+    }
+
+    /**
+     * ## STATIC `get_amount_out<W_IN, W_OUT>`
+     *
+     * Given an input amount of an asset and pair reserves with compile-time weights, returns the maximum output amount of the other asset
+     *
+     * The curve is selected at compile time (see `get_curve_kind`), no runtime ratio check or weight division
+     *
+     * ### params
+     *
+     * - `{uint64_t} W_IN` - reserve input weight (template)
+     * - `{uint64_t} W_OUT` - reserve output weight (template)
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t amount_out = balancer::get_amount_out<50, 50>( 10000, 45851931234, 125682033533 );
+     * // => 27328
+     * ```
+     */
+    template <uint64_t W_IN, uint64_t W_OUT, typename Check = checked>
+    static uint64_t get_amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint8_t fee = 30 )
+    {
+        BALANCER_COUNT(get_amount_out);
+
         // checks
-        eosio::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
-        eosio::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
-        eosio::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+        Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+        Check::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+
+        const curve_kind kind = weight_ratio<W_IN, W_OUT>::kind;
+#if defined(BALANCER_FIXED_POINT)
+        uint64_t amount_out;
+        if ( kind == curve_kind::pow_1 && detail::amount_out_equal(amount_in, reserve_in, reserve_out, fee, amount_out) ) {
+            BALANCER_COUNT(closed_form);
+            return amount_out;
+        }
+        BALANCER_COUNT(generic);
+        return detail::amount_out_fixed<Check>(amount_in, reserve_in, W_IN, reserve_out, W_OUT, fee);
+#else
+        if ( kind != curve_kind::generic ) {
+            BALANCER_COUNT(closed_form);
+            return detail::amount_out_closed_form(kind, amount_in, reserve_in, reserve_out, fee);
+        }
+        BALANCER_COUNT(generic);
 
         // calculations
-        const double weight_ratio = (static_cast<double>(reserve_weight_in) / reserve_weight_out);
-        const double amount_in_with_fee = amount_in * (10000 - fee);
-        const double numerator = (reserve_in * 10000) / ((reserve_in * 10000) + amount_in_with_fee);
-        const double denominator = 1 - pow(numerator, weight_ratio);
+        const double reserve_in_scaled = static_cast<double>(reserve_in) * 10000;
+        const double amount_in_with_fee = static_cast<double>(amount_in) * (10000 - fee);
+        const double denominator = -expm1(-(static_cast<double>(W_IN) / W_OUT) * log1p(amount_in_with_fee / reserve_in_scaled));
         const uint64_t amount_out = reserve_out * denominator;
 
         return amount_out;
+#endif
     }
 
     /**
-     * ## STATIC `get_amount_in`
+     * Maximum relative error of the `approx` curve functions against the exact curve (see `get_amount_out_approx`)
+     */
+    static constexpr double APPROX_MAX_ERROR = 1e-6;
+
+    namespace detail {
+        /**
+         * `log(1 + u)` for `u >= 0`, degree-7 odd series in `s = f / (2 + f)` (`|s| < 0.1716`), relative error below `1e-7`
+         */
+        static inline double log1p_approx( const double u )
+        {
+            double k = 0;
+            double f = u;
+            if ( u > SQRT2 - 1 ) {
+                const uint64_t bits = to_bits(1 + u);
+                double m = from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+                k = from_bits((bits >> 52) | 0x4330000000000000ULL) - 4503599627371519.0; // - (2^52 + 1023)
+                if ( m > SQRT2 ) { m = m * 0.5; k = k + 1.0; }
+                f = m - 1.0;
+            }
+            const double s = f / (2.0 + f);
+            const double z = s * s;
+            return k * (LN2_HI + LN2_LO) + 2.0 * s * (1.0 + z * (1.0 / 3 + z * (1.0 / 5 + z * (1.0 / 7))));
+        }
+
+        /**
+         * `e^t - 1` for `t <= 0`, degree-7 Taylor series near zero, 2^k times a degree-6 `e^r` (`|r| < ln2 / 2`) below,
+         * relative error below `5e-7`
+         */
+        static inline double expm1_approx( const double t )
+        {
+            if ( t > -0.34657359027997264 ) {
+                return t * (1.0 + t * (1.0 / 2 + t * (1.0 / 6 + t * (1.0 / 24 + t * (1.0 / 120 + t * (1.0 / 720 + t * (1.0 / 5040)))))));
+            }
+            if ( t < EXP_MIN ) return -1.0;
+
+            const double kr = t * INV_LN2 + ROUND;
+            const double k = kr - ROUND;
+            const double r = (t - k * LN2_HI) - k * LN2_LO;
+            const double p = 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720))))));
+            return p * from_bits((to_bits(kr) + 1023) << 52) - 1.0;
+        }
+    }
+
+    /**
+     * ## STATIC `get_amount_out_approx`
      *
-     * Given an output amount of an asset and pair reserves, returns a required input amount of the other asset.
+     * Given an input amount of an asset and pair reserves, returns the output amount within `APPROX_MAX_ERROR` (`1e-6`) relative error,
+     * for screening candidate trades before pricing them exactly with `get_amount_out`
+     *
+     * Closed-form weight ratios are evaluated exactly, other ratios replace `pow` with low-degree `log1p` / `expm1` polynomials
+     * (`-expm1(weight_ratio * -log1p(amount_in_with_fee / reserve_in))`, no cancellation for small trades)
      *
      * ### params
      *
-     * - `{uint64_t} amount_out` - amount input
+     * - `{double} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     *
+     * ### returns
+     *
+     * - `{double}` - output amount without truncation
+     *
+     * ### example
+     *
+     * ```c++
+     * const double amount_out = balancer::get_amount_out_approx( 100000, 833515447, 40, 10395237882, 60 );
+     * // => 828860.400467
+     * ```
+     */
+    template <typename Check = checked>
+    static double get_amount_out_approx( const double amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee = 30 )
+    {
+        // checks
+        Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+        Check::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+
+        // calculations
+        const curve_kind kind = get_curve_kind(reserve_weight_in, reserve_weight_out);
+        const double weight_ratio = static_cast<double>(reserve_weight_in) / reserve_weight_out;
+        const double amount_in_with_fee = amount_in * (1 - static_cast<double>(fee) / 10000);
+        if ( kind != curve_kind::generic ) {
+            const double sum = reserve_in + amount_in_with_fee;
+            return reserve_out * detail::curve_decay(kind, weight_ratio, reserve_in / sum, amount_in_with_fee / sum);
+        }
+        return reserve_out * -detail::expm1_approx(-weight_ratio * detail::log1p_approx(amount_in_with_fee / reserve_in));
+    }
+
+    /**
+     * ## STRUCT `curve_table`
+     *
+     * Precomputed curve tables for one weight pair, built once and shared read-only (no mutable state, safe across threads)
+     *
+     * `amount_out` evaluates `-expm1(-weight_ratio * log1p(u))` as `get_amount_out` does, both from tables: `log(1 + u) =
+     * e * ln2 + log(c) + log1p(t)` where `1 + u = 2^e * m`, `c` is the center of one of `SEGMENTS` mantissa segments and
+     * `t = (m - c) / c`, then `1 - exp(-L)` from `expm1(-j / SEGMENTS)` (`L <= 2`) or `2^-k * 2^(-j / SEGMENTS)` entries,
+     * every remainder below `1 / 128` is a degree-8 series. Small `u` and `L` use the series directly, so nothing cancels
+     *
+     * Matches `get_amount_out` (double build, see On-chain profile) within one unit plus `amount_out * MAX_ERROR` (`2^-49`),
+     * closed-form weight ratios use the same closed forms. `pow( x )` gives `x ^ weight_ratio` from the same segments
+     * (`2^(e * remain) * c ^ remain * (1 + t) ^ remain`, degree-6 binomial series)
+     *
+     * ### params
+     *
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     *
+     * ### example
+     *
+     * ```c++
+     * // Build once per distinct weight ratio
+     * const balancer::curve_table table( 40, 60 );
+     *
+     * // Calculation
+     * const uint64_t amount_out = table.amount_out( 100000, 833515447, 10395237882 );
+     * // => 828860
+     * ```
+     */
+    struct curve_table {
+        static constexpr size_t SEGMENTS = 64;
+        static constexpr size_t DEGREE = 6;
+        static constexpr int MIN_EXPONENT = -66;        // `get_amount_out` numerators stay above `2^-65`
+        static constexpr size_t SERIES = 8;
+        static constexpr size_t DECAY_SEGMENTS = 2 * SEGMENTS;      // `expm1` entries up to `L = 2`
+        static constexpr double MAX_ERROR = 1.0 / (1ULL << 49);    // output error per unit of `amount_out`
+        static constexpr double LN2_HI = 6.93147180369123816490e-01;   // ln(2) upper bits, `e * LN2_HI` is exact
+        static constexpr double LN2_LO = 1.90821492927058770002e-10;
+
+        curve_kind kind;
+        double weight_ratio;                            // reserve_weight_in / reserve_weight_out
+        uint64_t whole;                                 // floor(weight_ratio)
+        double remain;                                  // weight_ratio - whole
+        double coefficients[DEGREE + 1];                // binomial(remain, k)
+        double segment_pow[SEGMENTS];                   // c ^ remain
+        double segment_inv[SEGMENTS];                   // 1 / c
+        double exponent_pow[1 - MIN_EXPONENT];          // 2 ^ (-e * remain)
+        double segment_log[SEGMENTS];                   // log(c)
+        double decay_expm1[DECAY_SEGMENTS + 1];         // expm1(-j / SEGMENTS)
+        double decay_exp2[SEGMENTS];                    // 2 ^ (-j / SEGMENTS)
+        double log1p_coefficients[SERIES + 1];          // (-1)^k / (k + 1), log1p(x) / x
+        double decay_coefficients[SERIES + 1];          // (-1)^k / (k + 1)!, (1 - exp(-x)) / x
+
+        curve_table( const uint64_t reserve_weight_in, const uint64_t reserve_weight_out )
+        {
+            eosio::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+
+            kind = get_curve_kind(reserve_weight_in, reserve_weight_out);
+            weight_ratio = static_cast<double>(reserve_weight_in) / reserve_weight_out;
+            whole = reserve_weight_in / reserve_weight_out;
+            remain = weight_ratio - whole;
+
+            coefficients[0] = 1;
+            for ( size_t k = 1; k <= DEGREE; ++k ) coefficients[k] = coefficients[k - 1] * (remain - (k - 1)) / k;
+            for ( size_t i = 0; i < SEGMENTS; ++i ) {
+                const double center = 1 + (i + 0.5) / SEGMENTS;
+                segment_pow[i] = ::pow(center, remain);
+                segment_inv[i] = 1 / center;
+                segment_log[i] = ::log(center);
+                decay_exp2[i] = exp2(-static_cast<double>(i) / SEGMENTS);
+            }
+            for ( int e = 0; e <= -MIN_EXPONENT; ++e ) exponent_pow[e] = exp2(-e * remain);
+            for ( size_t j = 0; j <= DECAY_SEGMENTS; ++j ) decay_expm1[j] = ::expm1(-static_cast<double>(j) / SEGMENTS);
+            double factorial = 1;
+            for ( size_t k = 0; k <= SERIES; ++k ) {
+                factorial *= k + 1;
+                log1p_coefficients[k] = (k % 2 ? -1.0 : 1.0) / (k + 1);
+                decay_coefficients[k] = (k % 2 ? -1.0 : 1.0) / factorial;
+            }
+        }
+
+        /**
+         * `log1p(u)` for `u > 0`, series below `1 / 128`, otherwise segment lookup of `1 + u` (its rounding carried separately)
+         */
+        double log1p( const double u ) const
+        {
+            if ( u < 1.0 / 128 ) return u * log1p_series(u);
+
+            const double y = 1 + u;
+            const double rounding = u > 1 ? 1 - (y - u) : u - (y - 1);
+            const uint64_t bits = detail::to_bits(y);
+            const int e = static_cast<int>(bits >> 52) - 1023;
+            const size_t i = (bits >> (52 - 6)) & (SEGMENTS - 1);
+            const double m = detail::from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+            const double t = (m - (1 + (i + 0.5) / SEGMENTS)) * segment_inv[i];
+            return e * LN2_HI + (segment_log[i] + (t * log1p_series(t) + (e * LN2_LO + rounding / y)));
+        }
+
+        /**
+         * `1 - exp(-L)` for `L >= 0`, series below `1 / 128`, `expm1` entries up to `2`, `2^-k` with `2^(-j / SEGMENTS)` entries beyond
+         */
+        double decay( const double L ) const
+        {
+            if ( L < 1.0 / 128 ) return L * decay_series(L);
+            if ( L <= 2 ) {
+                const size_t j = static_cast<size_t>(L * SEGMENTS + 0.5);
+                const double rest = L - static_cast<double>(j) / SEGMENTS;
+                const double expm1_rest = -rest * decay_series(rest);
+                return -(decay_expm1[j] + expm1_rest * (1 + decay_expm1[j]));
+            }
+
+            if ( L >= 64 * LN2_HI ) return 1;           // exp(-L) below `2^-64`
+            const uint64_t n = static_cast<uint64_t>(L * (SEGMENTS / LN2_HI) + 0.5);
+            const uint64_t k = n / SEGMENTS;
+            const double rest = (L - n * (LN2_HI / SEGMENTS)) - n * (LN2_LO / SEGMENTS);
+            return 1 - detail::from_bits((1023 - k) << 52) * decay_exp2[n % SEGMENTS] * (1 - rest * decay_series(rest));
+        }
+
+        /**
+         * `x ^ weight_ratio` for `x` in `(0, 1]`, falls back to `pow` below `2^MIN_EXPONENT`
+         */
+        double pow( const double x ) const
+        {
+            const uint64_t bits = detail::to_bits(x);
+            const int e = static_cast<int>(bits >> 52) - 1023;
+            if ( e < MIN_EXPONENT ) return ::pow(x, weight_ratio);
+
+            // fractional power, segment lookup and binomial series
+            const size_t i = (bits >> (52 - 6)) & (SEGMENTS - 1);
+            const double m = detail::from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+            const double t = (m - (1 + (i + 0.5) / SEGMENTS)) * segment_inv[i];
+            double series = coefficients[DEGREE];
+            for ( size_t k = DEGREE; k > 0; --k ) series = series * t + coefficients[k - 1];
+            double result = exponent_pow[-e] * segment_pow[i] * series;
+
+            // whole power, square-and-multiply
+            double base = x;
+            for ( uint64_t n = whole; n > 0; n >>= 1 ) {
+                if ( n & 1 ) result *= base;
+                base *= base;
+            }
+            return result;
+        }
+
+        /**
+         * Maximum output amount for `amount_in` (see `get_amount_out`)
+         */
+        template <typename Check = checked>
+        uint64_t amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint8_t fee = 30 ) const
+        {
+            Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            Check::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            if ( kind != curve_kind::generic ) return detail::amount_out_closed_form(kind, amount_in, reserve_in, reserve_out, fee);
+
+            // 1 - (reserve_in / (reserve_in + amount_in_with_fee)) ^ weight_ratio, without cancellation for small trades
+            const double reserve_in_scaled = static_cast<double>(reserve_in) * 10000;
+            const double amount_in_with_fee = static_cast<double>(amount_in) * (10000 - fee);
+            const double denominator = decay(weight_ratio * log1p(amount_in_with_fee / reserve_in_scaled));
+            const uint64_t amount_out = reserve_out * denominator;
+            return amount_out;
+        }
+
+    private:
+        // log1p(x) / x for |x| < 1 / 128
+        double log1p_series( const double x ) const
+        {
+            double series = log1p_coefficients[SERIES];
+            for ( size_t k = SERIES; k > 0; --k ) series = series * x + log1p_coefficients[k - 1];
+            return series;
+        }
+
+        // (1 - exp(-x)) / x for |x| < 1 / 128
+        double decay_series( const double x ) const
+        {
+            double series = decay_coefficients[SERIES];
+            for ( size_t k = SERIES; k > 0; --k ) series = series * x + decay_coefficients[k - 1];
+            return series;
+        }
+    };
+
+    /**
+     * ## STATIC `get_amount_out_batch`
+     *
+     * Given many input amounts against the same pair reserves, writes the maximum output amount for each input
+     *
+     * Pool checks and pool constants (weight ratio, scaled reserve, fee factor) are evaluated once for the whole batch,
+     * each output is identical to calling `get_amount_out` with the same arguments (double build, see On-chain profile)
+     *
+     * ### params
+     *
+     * - `{const uint64_t*} amounts_in` - amounts input
+     * - `{uint64_t*} amounts_out` - amounts output (caller buffer of `count` elements)
+     * - `{size_t} count` - number of amounts
      * - `{uint64_t} reserve_in` - reserve input
      * - `{uint64_t} reserve_weight_in` - reserve input weight
      * - `{uint64_t} reserve_out` - reserve output
@@ -69,7 +1071,7 @@ namespace balancer {
      *
      * ```c++
      * // Inputs
-     * const uint64_t amount_out = 27328;
+     * const uint64_t amounts_in[] = { 10000, 20000, 30000 };
      * const uint64_t reserve_in = 45851931234;
      * const uint64_t reserve_weight_in = 50000;
      * const uint64_t reserve_out = 125682033533;
@@ -77,57 +1079,1870 @@ namespace balancer {
      * const uint8_t fee = 30;
      *
      * // Calculation
-     * const uint64_t amount_in = balancer::get_amount_in( amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
-     * // => 10000
+     * uint64_t amounts_out[3];
+     * balancer::get_amount_out_batch( amounts_in, amounts_out, 3, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
+     * // => [ 27328, 54656, 81984 ]
      * ```
      */
-    static uint64_t get_amount_in( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee = 30 )
+    template <typename Check = checked>
+    static void get_amount_out_batch( const uint64_t* amounts_in, uint64_t* amounts_out, const size_t count, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee = 30 )
     {
         // checks
-        eosio::check(amount_out > 0, "SX.Balancer: INSUFFICIENT_OUTPUT_AMOUNT");
-        eosio::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
 
-        const double weight_ratio = static_cast<double>(reserve_weight_in) / reserve_weight_out;
-        const double numerator = static_cast<double>(reserve_in) *  amount_out * 10000;
-        const double denominator = ((reserve_out - amount_out) * (10000 - fee)) * weight_ratio;
-        const uint64_t amount_in = 1 + ( numerator / denominator);
+        // closed-form weight ratios
+        const curve_kind kind = get_curve_kind(reserve_weight_in, reserve_weight_out);
+        if ( kind != curve_kind::generic ) {
+            for ( size_t i = 0; i < count; ++i ) {
+                Check::check(amounts_in[i] > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+                amounts_out[i] = detail::amount_out_closed_form(kind, amounts_in[i], reserve_in, reserve_out, fee);
+            }
+            return;
+        }
 
-        return amount_in;
+        // pool constants
+        const double weight_ratio = (static_cast<double>(reserve_weight_in) / reserve_weight_out);
+        const double reserve_in_scaled = static_cast<double>(reserve_in) * 10000;
+        const double fee_factor = 10000 - fee;
+
+        // calculations
+        for ( size_t i = 0; i < count; ++i ) {
+            Check::check(amounts_in[i] > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            const double amount_in_with_fee = static_cast<double>(amounts_in[i]) * fee_factor;
+            const double denominator = -expm1(-weight_ratio * log1p(amount_in_with_fee / reserve_in_scaled));
+            amounts_out[i] = reserve_out * denominator;
+        }
     }
 
     /**
-     * ## STATIC `quote`
+     * ## STATIC `get_amount_out_soa`
      *
-     * Given some amount of an asset and pair reserves, returns an equivalent amount of the other asset
+     * Given structure-of-arrays pools (one input amount per pool), writes the maximum output amount for each pool
+     *
+     * Every lane runs the `get_amount_out` kernel (closed-form dispatch, exact integer 50/50 curve, generic curve
+     * `-expm1(-weight_ratio * log1p(amount_in_with_fee / reserve_in))`), so each output is identical to `get_amount_out`
+     * in every build, without its per-call counters
      *
      * ### params
      *
-     * - `{uint64_t} amount_a` - amount A
-     * - `{uint64_t} reserve_a` - reserve A
-     * - `{uint64_t} reserve_weight_a` - reserve A weight
-     * - `{uint64_t} reserve_b` - reserve B
-     * - `{uint64_t} reserve_weight_b` - reserve B weight
+     * - `{const uint64_t*} amounts_in` - amounts input
+     * - `{uint64_t*} amounts_out` - amounts output (caller buffer of `count` elements)
+     * - `{size_t} count` - number of pools
+     * - `{const uint64_t*} reserves_in` - reserves input
+     * - `{const uint64_t*} reserve_weights_in` - reserves input weight
+     * - `{const uint64_t*} reserves_out` - reserves output
+     * - `{const uint64_t*} reserve_weights_out` - reserves output weight
+     * - `{const uint8_t*} fees` - trading fees (pips 1/100 of 1%)
      *
      * ### example
      *
      * ```c++
      * // Inputs
-     * const uint64_t amount_a = 10000;
-     * const uint64_t reserve_a = 45851931234;
-     * const uint64_t reserve_b = 125682033533;
-     * const uint64_t reserve_weight_a = 50000;
-     * const uint64_t reserve_weight_b = 50000;
+     * const uint64_t amounts_in[] = { 10000, 100000 };
+     * const uint64_t reserves_in[] = { 100000000, 833515447 };
+     * const uint64_t reserve_weights_in[] = { 500000, 20 };
+     * const uint64_t reserves_out[] = { 400000000, 10395237882 };
+     * const uint64_t reserve_weights_out[] = { 500000, 80 };
+     * const uint8_t fees[] = { 30, 30 };
      *
      * // Calculation
-     * const uint64_t amount_b = balancer::quote( amount_a, reserve_a, reserve_weight_a, reserve_b, reserve_weight_b );
-     * // => 27410
+     * uint64_t amounts_out[2];
+     * balancer::get_amount_out_soa( amounts_in, amounts_out, 2, reserves_in, reserve_weights_in, reserves_out, reserve_weights_out, fees );
+     * // => [ 39876, 310830 ]
      * ```
      */
-    static uint64_t quote( const uint64_t amount_a, const uint64_t reserve_a, const uint64_t reserve_weight_a, const uint64_t reserve_b, const uint64_t reserve_weight_b )
+    template <typename Check = checked>
+    static void get_amount_out_soa( const uint64_t* amounts_in, uint64_t* amounts_out, const size_t count, const uint64_t* reserves_in, const uint64_t* reserve_weights_in, const uint64_t* reserves_out, const uint64_t* reserve_weights_out, const uint8_t* fees )
     {
-        eosio::check(amount_a > 0, "SX.Balancer: INSUFFICIENT_AMOUNT");
-        eosio::check(reserve_a > 0 && reserve_b > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
-        const uint64_t amount_b = safemath::mul(amount_a, reserve_b * 10000 / reserve_weight_b) / (reserve_a * 10000 / reserve_weight_a);
-        return amount_b;
+        for ( size_t i = 0; i < count; ++i ) {
+            // checks
+            Check::check(amounts_in[i] > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            Check::check(reserves_in[i] > 0 && reserves_out[i] > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            Check::check(reserve_weights_in[i] > 0 && reserve_weights_out[i] > 0, "SX.Balancer: INVALID_WEIGHT");
+
+            // calculations, closed forms and the exact 50/50 curve per lane
+            const curve_kind kind = get_curve_kind(reserve_weights_in[i], reserve_weights_out[i]);
+            amounts_out[i] = detail::amount_out_weighted<Check>(kind, amounts_in[i], reserves_in[i], reserve_weights_in[i], reserves_out[i], reserve_weights_out[i], fees[i]);
+        }
     }
+
+    /**
+     * ## STATIC `get_amount_in`
+     *
+     * Given an output amount of an asset and pair reserves, returns a required input amount of the other asset.
+     *
+     * Exact inverse of the weighted curve `reserve_in * ((reserve_out / (reserve_out - amount_out)) ^ (reserve_weight_out / reserve_weight_in) - 1) / (1 - fee)`,
+     * rounded up: the result is the smallest input whose `get_amount_out( amount_in )` covers `amount_out`. Equal weights use
+     * exact integer math, other curves take the ceiling of the inverse and evaluate the forward curve once only when the inverse
+     * lands within rounding of an integer (inverses beyond the double resolution and the on-chain profile are searched)
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_out` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t amount_out = 27328;
+     * const uint64_t reserve_in = 45851931234;
+     * const uint64_t reserve_weight_in = 50000;
+     * const uint64_t reserve_out = 125682033533;
+     * const uint64_t reserve_weight_out = 50000;
+     * const uint8_t fee = 30;
+     *
+     * // Calculation
+     * const uint64_t amount_in = balancer::get_amount_in( amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
+     * // => 10000
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t get_amount_in( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee = 30 )
+    {
+        BALANCER_COUNT(get_amount_in);
+
+        // checks
+        Check::check(amount_out > 0, "SX.Balancer: INSUFFICIENT_OUTPUT_AMOUNT");
+        Check::check(reserve_in > 0 && reserve_out > amount_out, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+
+        // calculations
+        const curve_kind kind = get_curve_kind(reserve_weight_in, reserve_weight_out);
+        const curve_kind inverse_kind = get_curve_kind(reserve_weight_out, reserve_weight_in);
+        if ( inverse_kind != curve_kind::generic ) BALANCER_COUNT(closed_form);
+        else BALANCER_COUNT(generic);
+        const double inverse_ratio = static_cast<double>(reserve_weight_out) / reserve_weight_in;
+        const uint64_t amount_in = detail::amount_in_weighted<Check>(kind, inverse_kind, inverse_ratio, amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee);
+
+        return amount_in;
+    }
+
+    /**
+     * ## STATIC `quote`
+     *
+     * Given some amount of an asset and pair reserves, returns an equivalent amount of the other asset
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_a` - amount A
+     * - `{uint64_t} reserve_a` - reserve A
+     * - `{uint64_t} reserve_weight_a` - reserve A weight
+     * - `{uint64_t} reserve_b` - reserve B
+     * - `{uint64_t} reserve_weight_b` - reserve B weight
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t amount_a = 10000;
+     * const uint64_t reserve_a = 45851931234;
+     * const uint64_t reserve_b = 125682033533;
+     * const uint64_t reserve_weight_a = 50000;
+     * const uint64_t reserve_weight_b = 50000;
+     *
+     * // Calculation
+     * const uint64_t amount_b = balancer::quote( amount_a, reserve_a, reserve_weight_a, reserve_b, reserve_weight_b );
+     * // => 27410
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t quote( const uint64_t amount_a, const uint64_t reserve_a, const uint64_t reserve_weight_a, const uint64_t reserve_b, const uint64_t reserve_weight_b )
+    {
+        BALANCER_COUNT(quote);
+        Check::check(amount_a > 0, "SX.Balancer: INSUFFICIENT_AMOUNT");
+        Check::check(reserve_a > 0 && reserve_b > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        const uint128 weighted_reserve_a = static_cast<uint128>(reserve_a) * 10000 / reserve_weight_a;
+        const uint128 weighted_reserve_b = static_cast<uint128>(reserve_b) * 10000 / reserve_weight_b;
+        const uint64_t amount_b = detail::quote_weighted<Check>(amount_a, weighted_reserve_a, weighted_reserve_b);
+        return amount_b;
+    }
+
+    /**
+     * ## STRUCT `quote_price`
+     *
+     * Precomputed `weighted_reserve_b / weighted_reserve_a` of one pair as a 64.64 fixed-point price, quotes without division
+     *
+     * `price = floor(weighted_reserve_b * 2^64 / weighted_reserve_a)` is computed once, each quote is a 64x128 multiply-high
+     * (`estimate` is the exact quote or one less) and a multiply-only remainder check, results are identical to `quote`.
+     * Weighted reserves above 64 bits fall back to the division path of `quote`
+     *
+     * ### params
+     *
+     * - `{uint64_t} reserve_a` - reserve A
+     * - `{uint64_t} reserve_weight_a` - reserve A weight
+     * - `{uint64_t} reserve_b` - reserve B
+     * - `{uint64_t} reserve_weight_b` - reserve B weight
+     *
+     * ### example
+     *
+     * ```c++
+     * // Build once per pool
+     * const balancer::quote_price price( 45851931234, 50000, 125682033533, 50000 );
+     *
+     * // Calculation
+     * const uint64_t amount_b = price.quote( 10000 );
+     * // => 27410
+     * ```
+     */
+    struct quote_price {
+        uint128 weighted_reserve_a;     // reserve_a * 10000 / reserve_weight_a
+        uint128 weighted_reserve_b;     // reserve_b * 10000 / reserve_weight_b
+        uint128 price;                  // floor(weighted_reserve_b * 2^64 / weighted_reserve_a), 64.64 fixed-point
+        bool exact;                      // both weighted reserves fit 64 bits (multiply-high path)
+
+        quote_price( const uint64_t reserve_a, const uint64_t reserve_weight_a, const uint64_t reserve_b, const uint64_t reserve_weight_b )
+        {
+            eosio::check(reserve_a > 0 && reserve_b > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            eosio::check(reserve_weight_a > 0 && reserve_weight_b > 0, "SX.Balancer: INVALID_WEIGHT");
+
+            weighted_reserve_a = static_cast<uint128>(reserve_a) * 10000 / reserve_weight_a;
+            weighted_reserve_b = static_cast<uint128>(reserve_b) * 10000 / reserve_weight_b;
+            eosio::check(weighted_reserve_a > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+
+            exact = (weighted_reserve_a >> 64) == 0 && (weighted_reserve_b >> 64) == 0;
+            price = exact ? (weighted_reserve_b << 64) / weighted_reserve_a : 0;
+        }
+
+        /**
+         * Equivalent amount of asset B for `amount_a` (see `quote`)
+         */
+        template <typename Check = checked>
+        uint64_t quote( const uint64_t amount_a ) const
+        {
+            Check::check(amount_a > 0, "SX.Balancer: INSUFFICIENT_AMOUNT");
+            if ( !exact ) return detail::quote_weighted<Check>(amount_a, weighted_reserve_a, weighted_reserve_b);
+
+            // multiply-high, `price` truncation loses less than one unit
+            const uint128 low = static_cast<uint128>(amount_a) * static_cast<uint64_t>(price);
+            const uint128 estimate = static_cast<uint128>(amount_a) * static_cast<uint64_t>(price >> 64) + (low >> 64);
+
+            // exact rounding, `estimate * weighted_reserve_a <= amount_a * weighted_reserve_b < 2^128`
+            const uint128 remainder = static_cast<uint128>(amount_a) * static_cast<uint64_t>(weighted_reserve_b) - estimate * weighted_reserve_a;
+            const uint128 amount_b = estimate + (remainder >= weighted_reserve_a);
+            Check::check((amount_b >> 64) == 0, "SX.Balancer: OVERFLOW");
+            return amount_b;
+        }
+
+        /**
+         * Equivalent amounts of asset B for many `amounts_a` (caller buffer of `count` elements)
+         */
+        template <typename Check = checked>
+        void quote_batch( const uint64_t* amounts_a, uint64_t* amounts_b, const size_t count ) const
+        {
+            for ( size_t i = 0; i < count; ++i ) amounts_b[i] = quote<Check>(amounts_a[i]);
+        }
+    };
+
+    /**
+     * ## STATIC `quote_batch`
+     *
+     * Given many amounts of an asset against the same pair reserves, writes the equivalent amount of the other asset for each
+     *
+     * The pool price is computed once (see `quote_price`), each quote is a multiply-high without division, each output is
+     * identical to calling `quote` with the same arguments
+     *
+     * ### params
+     *
+     * - `{const uint64_t*} amounts_a` - amounts A
+     * - `{uint64_t*} amounts_b` - amounts B (caller buffer of `count` elements)
+     * - `{size_t} count` - number of amounts
+     * - `{uint64_t} reserve_a` - reserve A
+     * - `{uint64_t} reserve_weight_a` - reserve A weight
+     * - `{uint64_t} reserve_b` - reserve B
+     * - `{uint64_t} reserve_weight_b` - reserve B weight
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t amounts_a[] = { 10000, 20000, 30000 };
+     *
+     * // Calculation
+     * uint64_t amounts_b[3];
+     * balancer::quote_batch( amounts_a, amounts_b, 3, 45851931234, 50000, 125682033533, 50000 );
+     * // => [ 27410, 54820, 82231 ]
+     * ```
+     */
+    template <typename Check = checked>
+    static void quote_batch( const uint64_t* amounts_a, uint64_t* amounts_b, const size_t count, const uint64_t reserve_a, const uint64_t reserve_weight_a, const uint64_t reserve_b, const uint64_t reserve_weight_b )
+    {
+        BALANCER_COUNT(quote);
+        const quote_price price(reserve_a, reserve_weight_a, reserve_b, reserve_weight_b);
+        price.quote_batch<Check>(amounts_a, amounts_b, count);
+    }
+
+    // fixed-point math (18 decimals), Balancer `BNum`
+    static constexpr uint128 BONE = 1000000000000000000ULL;
+    static constexpr uint128 MIN_BPOW_BASE = 1;
+    static constexpr uint128 MAX_BPOW_BASE = 2 * BONE - 1;
+    static constexpr uint128 BPOW_PRECISION = BONE / 10000000000ULL;
+    static constexpr uint32_t BPOW_MAX_ITERATIONS = 256;
+
+    static constexpr uint128 bmul( const uint128 a, const uint128 b )
+    {
+        return (a * b + BONE / 2) / BONE;
+    }
+
+    static constexpr uint128 bdiv( const uint128 a, const uint128 b )
+    {
+        return (a * BONE + b / 2) / b;
+    }
+
+    /**
+     * `numerator / denominator` as fixed-point, operands are scaled down (relative error `2^-68`) when `numerator * BONE` would overflow
+     */
+    static constexpr uint128 bratio( uint128 numerator, uint128 denominator )
+    {
+        const uint64_t high = numerator >> 64;
+        const int bits = high ? 128 - __builtin_clzll(high) : (numerator ? 64 - __builtin_clzll(static_cast<uint64_t>(numerator)) : 0);
+        if ( bits > 68 ) {
+            numerator >>= bits - 68;
+            denominator >>= bits - 68;
+            if ( denominator == 0 ) denominator = 1;
+        }
+        return numerator * BONE / denominator;
+    }
+
+    /**
+     * `a ^ n` with `a` fixed-point and `n` a whole number
+     */
+    static constexpr uint128 bpowi( uint128 a, uint128 n )
+    {
+        uint128 z = n % 2 != 0 ? a : BONE;
+        for ( n /= 2; n != 0; n /= 2 ) {
+            a = bmul(a, a);
+            if ( n % 2 != 0 ) z = bmul(z, a);
+        }
+        return z;
+    }
+
+    /**
+     * `base ^ exp` for fractional `exp` in `[0, 1)`, binomial series `(1 + x) ^ exp` summed until a term drops below
+     * `precision` or `max_iterations` terms were added
+     */
+    static constexpr uint128 bpow_approx( const uint128 base, const uint128 exp, const uint128 precision, const uint32_t max_iterations )
+    {
+        const bool xneg = base < BONE;
+        const uint128 x = xneg ? BONE - base : base - BONE;
+        uint128 term = BONE;
+        uint128 sum = term;
+        bool negative = false;
+
+        for ( uint32_t i = 1; term >= precision && i <= max_iterations; ++i ) {
+            const uint128 big_k = i * BONE;
+            const bool cneg = exp < big_k - BONE;
+            const uint128 c = cneg ? big_k - BONE - exp : exp - (big_k - BONE);
+            term = bdiv(bmul(term, bmul(c, x)), big_k);
+            if ( term == 0 ) break;
+
+            if ( xneg ) negative = !negative;
+            if ( cneg ) negative = !negative;
+            if ( negative ) sum = sum - term;
+            else sum = sum + term;
+        }
+        return sum;
+    }
+
+    /**
+     * ## STATIC `bpow`
+     *
+     * Fixed-point `base ^ exp` (18 decimals) using only integer arithmetic, bit-identical on every node
+     *
+     * ### params
+     *
+     * - `{uint128} base` - fixed-point base in `[MIN_BPOW_BASE, MAX_BPOW_BASE]`
+     * - `{uint128} exp` - fixed-point exponent
+     * - `{uint128} [precision=BPOW_PRECISION]` - (optional) smallest series term added
+     * - `{uint32_t} [max_iterations=BPOW_MAX_ITERATIONS]` - (optional) maximum series terms added
+     *
+     * ### example
+     *
+     * ```c++
+     * const balancer::uint128 z = balancer::bpow( balancer::BONE / 4, balancer::BONE / 2 );
+     * // => 500000000254041274 (0.5 within BPOW_PRECISION)
+     * ```
+     */
+    template <typename Check = checked>
+    static constexpr uint128 bpow( const uint128 base, const uint128 exp, const uint128 precision = BPOW_PRECISION, const uint32_t max_iterations = BPOW_MAX_ITERATIONS )
+    {
+        Check::check(base >= MIN_BPOW_BASE && base <= MAX_BPOW_BASE, "SX.Balancer: BPOW_BASE_OUT_OF_RANGE");
+
+        const uint128 whole = exp / BONE;
+        const uint128 remain = exp - whole * BONE;
+        const uint128 whole_pow = bpowi(base, whole);
+        if ( remain == 0 ) return whole_pow;
+
+        return bmul(whole_pow, bpow_approx(base, remain, precision, max_iterations));
+    }
+
+    namespace detail {
+        /**
+         * Fixed-point curve base `reserve_in / (reserve_in + amount_in_with_fee)`, at least `MIN_BPOW_BASE`
+         */
+        constexpr uint128 fixed_numerator( const uint64_t amount_in, const uint64_t reserve_in, const uint32_t fee )
+        {
+            const uint128 reserve_in_scaled = static_cast<uint128>(reserve_in) * 10000;
+            const uint128 numerator = bratio(reserve_in_scaled, reserve_in_scaled + static_cast<uint128>(amount_in) * (10000 - fee));
+            return numerator > 0 ? numerator : MIN_BPOW_BASE;
+        }
+
+        /**
+         * Binomial coefficients of `(1 + x) ^ exp` for a fixed `exp` in `[0, 1)`, the exponent-only half of `bpow_approx`
+         */
+        template <size_t N>
+        struct bpow_table {
+            uint128 coefficients[N];
+            bool negative[N];
+            size_t size;
+
+            constexpr bpow_table( const uint128 exp ) : coefficients{}, negative{}, size( 0 )
+            {
+                uint128 coefficient = BONE;
+                bool sign = false;
+                for ( size_t i = 1; i <= N; ++i ) {
+                    const uint128 big_k = i * BONE;
+                    const bool cneg = exp < big_k - BONE;
+                    const uint128 c = cneg ? big_k - BONE - exp : exp - (big_k - BONE);
+                    coefficient = bdiv(bmul(coefficient, c), big_k);
+                    if ( coefficient == 0 ) break;
+
+                    if ( cneg ) sign = !sign;
+                    coefficients[size] = coefficient;
+                    negative[size] = sign;
+                    ++size;
+                }
+            }
+
+            /**
+             * `base ^ exp`, terms are summed until one drops below `precision`
+             */
+            constexpr uint128 evaluate( const uint128 base, const uint128 precision ) const
+            {
+                const bool xneg = base < BONE;
+                const uint128 x = xneg ? BONE - base : base - BONE;
+                uint128 power = BONE;
+                uint128 sum = BONE;
+
+                for ( size_t i = 0; i < size; ++i ) {
+                    power = bmul(power, x);
+                    const uint128 term = bmul(coefficients[i], power);
+                    if ( term < precision ) break;
+
+                    // sign of `c(k) * x^k`
+                    if ( negative[i] != (xneg && i % 2 == 0) ) sum = sum - term;
+                    else sum = sum + term;
+                }
+                return sum;
+            }
+        };
+    }
+
+    /**
+     * ## STRUCT `static_pool<W_IN, W_OUT, FEE>`
+     *
+     * Compile-time weights and fee, the weight ratio, fee factor and `bpow` series coefficients are constants
+     *
+     * `amount_out` is integer-only and `constexpr`, with constant reserves the whole trade folds at compile time
+     * (a failed check is then a compile error)
+     *
+     * ### params
+     *
+     * - `{uint64_t} W_IN` - reserve input weight (template)
+     * - `{uint64_t} W_OUT` - reserve output weight (template)
+     * - `{uint8_t} [FEE=30]` - (optional) trading fee (pips 1/100 of 1%, template)
+     *
+     * ### example
+     *
+     * ```c++
+     * typedef balancer::static_pool<20, 80> pool_20_80;
+     *
+     * constexpr uint64_t amount_out = pool_20_80::amount_out( 100000, 833515447, 10395237882 );
+     * static_assert( amount_out == 310830, "compile-time quote" );
+     * ```
+     */
+    template <uint64_t W_IN, uint64_t W_OUT, uint8_t FEE = 30>
+    struct static_pool {
+        static_assert(W_IN > 0 && W_OUT > 0, "SX.Balancer: INVALID_WEIGHT");
+
+        static constexpr size_t TABLE_SIZE = 64;
+        static constexpr uint128 weight_ratio = bdiv(W_IN, W_OUT);
+        static constexpr uint128 whole = weight_ratio / BONE;
+        static constexpr uint128 remain = weight_ratio % BONE;
+        static constexpr uint64_t fee_factor = 10000 - FEE;
+        static constexpr detail::bpow_table<TABLE_SIZE> table = detail::bpow_table<TABLE_SIZE>(remain);
+
+        /**
+         * Fixed-point `base ^ weight_ratio` against the compile-time coefficient table
+         */
+        static constexpr uint128 pow( const uint128 base, const uint128 precision = BPOW_PRECISION )
+        {
+            const uint128 whole_pow = bpowi(base, whole);
+            return remain == 0 ? whole_pow : bmul(whole_pow, table.evaluate(base, precision));
+        }
+
+        /**
+         * Maximum output amount for `amount_in` (see `get_amount_out_fixed`)
+         */
+        template <typename Check = checked>
+        static constexpr uint64_t amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint128 precision = BPOW_PRECISION )
+        {
+            Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            Check::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+
+            const uint128 numerator = detail::fixed_numerator(amount_in, reserve_in, FEE);
+            return static_cast<uint128>(reserve_out) * (BONE - pow(numerator, precision)) / BONE;
+        }
+    };
+
+    template <uint64_t W_IN, uint64_t W_OUT, uint8_t FEE>
+    constexpr detail::bpow_table<static_pool<W_IN, W_OUT, FEE>::TABLE_SIZE> static_pool<W_IN, W_OUT, FEE>::table;
+
+    /**
+     * ## STATIC `get_amount_out_fixed`
+     *
+     * Given an input amount of an asset and pair reserves, returns the maximum output amount of the other asset
+     *
+     * Integer-only equivalent of `get_amount_out` (no libm, no floating point), results are identical on every node,
+     * `precision` and `max_iterations` trade accuracy for CPU
+     *
+     * As Balancer `calcOutGivenIn`, `amount_in` is limited to half of `reserve_in` (bases below `2/3` would exhaust the
+     * `bpow` iteration limit before reaching `precision`)
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     * - `{uint128} [precision=BPOW_PRECISION]` - (optional) smallest `bpow` series term added
+     * - `{uint32_t} [max_iterations=BPOW_MAX_ITERATIONS]` - (optional) maximum `bpow` series terms added
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t amount_in = 10000;
+     * const uint64_t reserve_in = 45851931234;
+     * const uint64_t reserve_weight_in = 50000;
+     * const uint64_t reserve_out = 125682033533;
+     * const uint64_t reserve_weight_out = 50000;
+     * const uint8_t fee = 30;
+     *
+     * // Calculation
+     * const uint64_t amount_out = balancer::get_amount_out_fixed( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
+     * // => 27328
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t get_amount_out_fixed( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee = 30, const uint128 precision = BPOW_PRECISION, const uint32_t max_iterations = BPOW_MAX_ITERATIONS )
+    {
+        // checks
+        Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+        Check::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+        Check::check(static_cast<uint128>(amount_in) * 2 <= reserve_in, "SX.Balancer: MAX_IN_RATIO");
+
+        // calculations
+        const uint128 weight_ratio = bdiv(reserve_weight_in, reserve_weight_out);
+        const uint128 numerator = detail::fixed_numerator(amount_in, reserve_in, fee);
+        const uint128 denominator = BONE - bpow<Check>(numerator, weight_ratio, precision, max_iterations);
+        const uint64_t amount_out = static_cast<uint128>(reserve_out) * denominator / BONE;
+
+        return amount_out;
+    }
+
+    namespace detail {
+        /**
+         * Halves `value` below `2^64`, counting the halvings in `shift`
+         */
+        static inline uint128 bnormalize( uint128 value, uint32_t& shift )
+        {
+            while ( value >> 64 ) {
+                value >>= 1;
+                ++shift;
+            }
+            return value;
+        }
+
+        /**
+         * `base ^ exp = power * 2^shift` for `base` in `[BONE, MAX_BPOW_BASE]` (see `bpow`), the power and the repeated
+         * squares are renormalized below `2^64` as they grow, so every `bmul` stays within 128 bits for any exponent
+         */
+        template <typename Check>
+        static inline uint128 bpow_growth( const uint128 base, const uint128 exp, const uint128 precision, const uint32_t max_iterations, uint32_t& shift )
+        {
+            Check::check(base >= BONE && base <= MAX_BPOW_BASE, "SX.Balancer: BPOW_BASE_OUT_OF_RANGE");
+
+            uint128 power = BONE;
+            uint128 square = base;
+            uint32_t square_shift = 0;
+            shift = 0;
+            for ( uint128 n = exp / BONE; n != 0; n /= 2 ) {
+                Check::check(shift < 128 && square_shift < 128, "SX.Balancer: OVERFLOW");
+                if ( n % 2 != 0 ) {
+                    shift += square_shift;
+                    power = bnormalize(bmul(power, square), shift);
+                }
+                if ( n > 1 ) {
+                    square_shift *= 2;
+                    square = bnormalize(bmul(square, square), square_shift);
+                }
+            }
+            const uint128 remain = exp % BONE;
+            if ( remain == 0 ) return power;
+            return bnormalize(bmul(power, bpow_approx(base, remain, precision, max_iterations)), shift);
+        }
+    }
+
+    /**
+     * ## STATIC `get_amount_in_fixed`
+     *
+     * Given an output amount of an asset and pair reserves, returns a required input amount of the other asset using
+     * 18-decimal fixed-point math, Balancer `calcInGivenOut` (see `get_amount_in`)
+     *
+     * As Balancer, `amount_out` is limited to a third of `reserve_out` (`bpow` series of bases up to `1.5` converge within
+     * the iteration limit) and the result to half of `reserve_in` (see `get_amount_out_fixed`). The estimate is rounded up
+     * and verified forward, when `bpow` rounding leaves it short it is raised until `get_amount_out_fixed( amount_in )`
+     * covers `amount_out` (within about `2^-26` relative of the smallest covering input)
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_out` - amount output
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     * - `{uint128} [precision=BPOW_PRECISION]` - (optional) `bpow` series precision
+     * - `{uint32_t} [max_iterations=BPOW_MAX_ITERATIONS]` - (optional) `bpow` series maximum terms
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t amount_out = 310830;
+     * const uint64_t reserve_in = 833515447;
+     * const uint64_t reserve_weight_in = 20;
+     * const uint64_t reserve_out = 10395237882;
+     * const uint64_t reserve_weight_out = 80;
+     *
+     * // Calculation
+     * const uint64_t amount_in = balancer::get_amount_in_fixed( amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
+     * // => 100000
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t get_amount_in_fixed( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee = 30, const uint128 precision = BPOW_PRECISION, const uint32_t max_iterations = BPOW_MAX_ITERATIONS )
+    {
+        // checks
+        Check::check(amount_out > 0, "SX.Balancer: INSUFFICIENT_OUTPUT_AMOUNT");
+        Check::check(reserve_in > 0 && reserve_out > amount_out, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+        Check::check(static_cast<uint128>(amount_out) * 3 <= reserve_out, "SX.Balancer: MAX_OUT_RATIO");
+
+        // calculations
+        const uint128 weight_ratio = bdiv(reserve_weight_out, reserve_weight_in);
+        const uint128 base = bratio(reserve_out, reserve_out - amount_out);
+        uint32_t shift;
+        const uint128 power = detail::bpow_growth<Check>(base, weight_ratio, precision, max_iterations, shift);
+
+        // reserve_in * (power * 2^shift - BONE) / BONE, `power` is below 2^64
+        const uint128 scaled = static_cast<uint128>(reserve_in) * power;
+        Check::check(shift < 64 && (shift == 0 || (scaled >> (128 - shift)) == 0), "SX.Balancer: OVERFLOW");
+        const uint128 reserve_grown = (scaled << shift) / BONE;
+        const uint128 growth = reserve_grown > reserve_in ? reserve_grown - reserve_in : 0;
+        const uint128 estimate = (growth * 10000 + (10000 - fee) - 1) / (10000 - fee);
+        Check::check((estimate >> 64) == 0, "SX.Balancer: OVERFLOW");
+
+        // `bpow` rounding may leave the estimate short, raised until the forward curve covers `amount_out`
+        uint64_t amount_in = estimate > 0 ? estimate : 1;
+        for ( uint64_t step = 1 + (amount_in >> 26); get_amount_out_fixed<unchecked>(amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee, precision, max_iterations) < amount_out; step <<= 1 ) {
+            const bool fits = step != 0 && amount_in <= UINT64_MAX - step;
+            Check::check(fits, "SX.Balancer: OVERFLOW");
+            if ( !fits ) return UINT64_MAX;
+            amount_in += step;
+        }
+        Check::check(static_cast<uint128>(amount_in) * 2 <= reserve_in, "SX.Balancer: MAX_IN_RATIO");
+
+        return amount_in;
+    }
+
+#if defined(BALANCER_FIXED_POINT)
+    namespace detail {
+        template <typename Check>
+        static uint64_t amount_out_fixed( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee )
+        {
+            return get_amount_out_fixed<Check>(amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee);
+        }
+
+        template <typename Check>
+        static uint64_t amount_in_fixed( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee )
+        {
+            return get_amount_in_fixed<Check>(amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee);
+        }
+    }
+#endif
+
+    /**
+     * Curve value with its first and second derivative at one input amount
+     */
+    struct curve_point {
+        double amount_out;          // out(amount_in)
+        double derivative;          // d(out) / d(in)
+        double second_derivative;   // d2(out) / d(in)2
+    };
+
+    /**
+     * ## STATIC `get_amount_out_with_derivative`
+     *
+     * Given a (fractional) input amount of an asset and pair reserves, returns the output amount with its first and second
+     * derivative with respect to the input amount
+     *
+     * All three share one `x ^ weight_ratio` term, `x = reserve_in / (reserve_in + amount_in_with_fee)`:
+     * `out' = reserve_out * weight_ratio * fee_factor * x^weight_ratio / (reserve_in + amount_in_with_fee)` and
+     * `out'' = -out' * (weight_ratio + 1) * fee_factor / (reserve_in + amount_in_with_fee)`. The output is the real curve value,
+     * `get_amount_out` rounds it down; `amount_in = 0` returns the marginal price after fee
+     *
+     * ### params
+     *
+     * - `{double} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * // Calculation
+     * const balancer::curve_point point = balancer::get_amount_out_with_derivative( 100000, 833515447, 20, 10395237882, 80 );
+     * // => { amount_out: 310830.39, derivative: 3.10807, second_derivative: -4.6465e-9 }
+     * ```
+     */
+    template <typename Check = checked>
+    static curve_point get_amount_out_with_derivative( const double amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee = 30 )
+    {
+        // checks
+        Check::check(amount_in >= 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+        Check::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+
+        // calculations
+        const curve_kind kind = get_curve_kind(reserve_weight_in, reserve_weight_out);
+        const double weight_ratio = static_cast<double>(reserve_weight_in) / reserve_weight_out;
+        const double fee_factor = 1 - static_cast<double>(fee) / 10000;
+        const double amount_in_with_fee = amount_in * fee_factor;
+        const double sum = reserve_in + amount_in_with_fee;
+        const double decay = detail::curve_decay(kind, weight_ratio, reserve_in / sum, amount_in_with_fee / sum);
+
+        curve_point point;
+        point.amount_out = reserve_out * decay;
+        point.derivative = reserve_out * weight_ratio * fee_factor * (1 - decay) / sum;
+        point.second_derivative = -point.derivative * (weight_ratio + 1) * fee_factor / sum;
+        return point;
+    }
+
+    /**
+     * Output of one trade with its input fee split between liquidity providers and the protocol
+     */
+    struct fee_split {
+        uint64_t amount_out;        // see `get_amount_out`, `amount_in` net of both fees
+        uint64_t trade_fee;         // input amount kept by the pool (liquidity providers)
+        uint64_t protocol_fee;      // input amount owed to the protocol
+    };
+
+    /**
+     * ## STATIC `get_amount_out_with_fees`
+     *
+     * Given an input amount of an asset and pair reserves, returns the maximum output amount of the other asset and the
+     * trade / protocol fee amounts charged on the input, from one curve evaluation
+     *
+     * Fees are `uint16_t` pips (`trade_fee + protocol_fee` below `10000`), the output equals `get_amount_out` with
+     * `fee = trade_fee + protocol_fee`. The total fee amount `ceil(amount_in * fee / 10000)` is split pro rata, the protocol
+     * part rounded down, so `trade_fee + protocol_fee` of the result never undercharges the pool
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint16_t} [trade_fee=30]` - (optional) trading fee kept by the pool (pips 1/100 of 1%)
+     * - `{uint16_t} [protocol_fee=0]` - (optional) protocol fee (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const balancer::fee_split split = balancer::get_amount_out_with_fees( 100000, 833515447, 20, 10395237882, 80, 25, 5 );
+     * // split.amount_out => 310830
+     * // split.trade_fee => 250
+     * // split.protocol_fee => 50
+     * ```
+     */
+    template <typename Check = checked>
+    static fee_split get_amount_out_with_fees( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint16_t trade_fee = 30, const uint16_t protocol_fee = 0 )
+    {
+        BALANCER_COUNT(get_amount_out_with_fees);
+
+        // checks
+        Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+        Check::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+        Check::check(static_cast<uint32_t>(trade_fee) + protocol_fee < 10000, "SX.Balancer: INVALID_FEE");
+
+        // fee amounts
+        const uint16_t fee = trade_fee + protocol_fee;
+        uint64_t amount_in_net, protocol_product;
+        if ( __builtin_mul_overflow(amount_in, 10000 - fee, &amount_in_net) ) amount_in_net = static_cast<uint128>(amount_in) * (10000 - fee) / 10000;
+        else amount_in_net /= 10000;
+        const uint64_t fee_amount = amount_in - amount_in_net;
+        fee_split result;
+        if ( fee == 0 ) result.protocol_fee = 0;
+        else if ( __builtin_mul_overflow(fee_amount, protocol_fee, &protocol_product) ) result.protocol_fee = static_cast<uint128>(fee_amount) * protocol_fee / fee;
+        else result.protocol_fee = protocol_product / fee;
+        result.trade_fee = fee_amount - result.protocol_fee;
+
+        // curve, once for the combined fee
+        const curve_kind kind = get_curve_kind(reserve_weight_in, reserve_weight_out);
+#if defined(BALANCER_FIXED_POINT)
+        if ( kind == curve_kind::pow_1 && detail::amount_out_equal(amount_in, reserve_in, reserve_out, fee, result.amount_out) ) {
+            BALANCER_COUNT(closed_form);
+            return result;
+        }
+        BALANCER_COUNT(generic);
+        const uint128 weight_ratio = bdiv(reserve_weight_in, reserve_weight_out);
+        const uint128 numerator = detail::fixed_numerator(amount_in, reserve_in, fee);
+        result.amount_out = static_cast<uint128>(reserve_out) * (BONE - bpow<Check>(numerator, weight_ratio)) / BONE;
+#else
+        if ( kind != curve_kind::generic ) {
+            BALANCER_COUNT(closed_form);
+            result.amount_out = detail::amount_out_closed_form(kind, amount_in, reserve_in, reserve_out, fee);
+            return result;
+        }
+        BALANCER_COUNT(generic);
+        const double weight_ratio = (static_cast<double>(reserve_weight_in) / reserve_weight_out);
+        const double reserve_in_scaled = static_cast<double>(reserve_in) * 10000;
+        const double amount_in_with_fee = static_cast<double>(amount_in) * (10000 - fee);
+        result.amount_out = reserve_out * -expm1(-weight_ratio * log1p(amount_in_with_fee / reserve_in_scaled));
+#endif
+        return result;
+    }
+
+    /**
+     * Fused pricing of one trade (see `pool::prices`), prices are fixed-point (18 decimals, `BONE = 1.0`)
+     */
+    struct pool_prices {
+        uint64_t amount_out;            // see `get_amount_out`
+        uint64_t quote;                 // see `quote`
+        uint128 spot_price;             // marginal output per input
+        uint128 spot_price_with_fee;    // marginal output per input after fee
+        uint128 price_impact;           // 1 - (amount_out / amount_in) / spot_price_with_fee
+    };
+
+    /**
+     * ## STRUCT `pool`
+     *
+     * Precomputed pair state, built once from reserves, weights and fee
+     *
+     * Caches the weight ratio, the scaled input reserve, the fee factor and the weighted reserves,
+     * members only evaluate the per-trade part of each formula
+     *
+     * ### params
+     *
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_weight_in` - reserve input weight
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} reserve_weight_out` - reserve output weight
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * balancer::pool pool( 45851931234, 50000, 125682033533, 50000, 30 );
+     *
+     * // Calculation
+     * const uint64_t amount_out = pool.amount_out( 10000 );
+     * // => 27328
+     *
+     * // Simulate trade
+     * pool.apply_swap( 10000, amount_out );
+     * ```
+     */
+    struct pool {
+        uint64_t reserve_in;
+        uint64_t reserve_weight_in;
+        uint64_t reserve_out;
+        uint64_t reserve_weight_out;
+        uint8_t fee;
+
+        // cached terms
+        curve_kind kind;                // closed-form weight ratio
+        curve_kind inverse_kind;        // closed-form inverse weight ratio
+        double weight_ratio;            // reserve_weight_in / reserve_weight_out
+        double inverse_ratio;           // reserve_weight_out / reserve_weight_in
+        double reserve_in_scaled;       // reserve_in * 10000
+        double fee_factor;              // 1 - fee / 10000
+        uint128 weighted_reserve_in;    // reserve_in * 10000 / reserve_weight_in
+        uint128 weighted_reserve_out;   // reserve_out * 10000 / reserve_weight_out
+        uint128 spot_price;             // (reserve_out / reserve_weight_out) / (reserve_in / reserve_weight_in), fixed-point
+
+        pool( const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee = 30 )
+            : reserve_in( reserve_in ),
+              reserve_weight_in( reserve_weight_in ),
+              reserve_out( reserve_out ),
+              reserve_weight_out( reserve_weight_out ),
+              fee( fee )
+        {
+            // checks
+            eosio::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            eosio::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+
+            kind = get_curve_kind(reserve_weight_in, reserve_weight_out);
+            inverse_kind = get_curve_kind(reserve_weight_out, reserve_weight_in);
+            weight_ratio = static_cast<double>(reserve_weight_in) / reserve_weight_out;
+            inverse_ratio = static_cast<double>(reserve_weight_out) / reserve_weight_in;
+            fee_factor = 1 - static_cast<double>(fee) / 10000;
+            update_reserves();
+        }
+
+        /**
+         * Pool from weight terms cached elsewhere (see `mapped_snapshot::pool`), `kind` / `weight_ratio` of
+         * `reserve_weight_in / reserve_weight_out` and their inverses, trusted to match the weights
+         */
+        pool( const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee,
+              const curve_kind kind, const curve_kind inverse_kind, const double weight_ratio, const double inverse_ratio )
+            : reserve_in( reserve_in ),
+              reserve_weight_in( reserve_weight_in ),
+              reserve_out( reserve_out ),
+              reserve_weight_out( reserve_weight_out ),
+              fee( fee ),
+              kind( kind ),
+              inverse_kind( inverse_kind ),
+              weight_ratio( weight_ratio ),
+              inverse_ratio( inverse_ratio )
+        {
+            // checks
+            eosio::check(reserve_in > 0 && reserve_out > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            eosio::check(reserve_weight_in > 0 && reserve_weight_out > 0, "SX.Balancer: INVALID_WEIGHT");
+
+            fee_factor = 1 - static_cast<double>(fee) / 10000;
+            update_reserves();
+        }
+
+        /**
+         * Maximum output amount for `amount_in` (see `get_amount_out`)
+         *
+         * Closed-form weight ratios match `get_amount_out`, other ratios are evaluated as
+         * `-expm1(-weight_ratio * log1p(amount_in_with_fee / reserve_in))` like `get_amount_out`, without cancellation for
+         * small trades against large reserves (double curve in every build, see On-chain profile)
+         */
+        template <typename Check = checked>
+        uint64_t amount_out( const uint64_t amount_in ) const
+        {
+            Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            if ( kind != curve_kind::generic ) return detail::amount_out_closed_form(kind, amount_in, reserve_in, reserve_out, fee);
+            return amount_out_precise<Check>(amount_in);
+        }
+
+        /**
+         * Output amount for a fractional `amount_in`, without truncation
+         */
+        template <typename Check = checked>
+        double amount_out_precise( const double amount_in ) const
+        {
+            Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+
+            // 1 - (reserve_in / (reserve_in + amount_in_with_fee)) ^ weight_ratio
+            const double amount_in_with_fee = amount_in * fee_factor;
+            if ( kind == curve_kind::generic ) {
+                return reserve_out * -expm1(-weight_ratio * log1p(amount_in_with_fee / reserve_in));
+            }
+            const double sum = reserve_in + amount_in_with_fee;
+            return reserve_out * detail::curve_decay(kind, weight_ratio, reserve_in / sum, amount_in_with_fee / sum);
+        }
+
+        /**
+         * Output amount for a fractional `amount_in` within `APPROX_MAX_ERROR` relative error (see `get_amount_out_approx`)
+         */
+        template <typename Check = checked>
+        double amount_out_approx( const double amount_in ) const
+        {
+            Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            if ( kind != curve_kind::generic ) return amount_out_precise<Check>(amount_in);
+            return reserve_out * -detail::expm1_approx(-weight_ratio * detail::log1p_approx(amount_in * fee_factor / reserve_in));
+        }
+
+        /**
+         * Output amount and its derivatives for a fractional `amount_in`, sharing one `x ^ weight_ratio` term
+         *
+         * `x = reserve_in / (reserve_in + amount_in_with_fee)`, `out' = reserve_out * weight_ratio * fee_factor * x^weight_ratio / (reserve_in + amount_in_with_fee)`
+         */
+        curve_point curve_at( const double amount_in ) const
+        {
+            const double amount_in_with_fee = amount_in * fee_factor;
+            const double sum = reserve_in + amount_in_with_fee;
+            const double decay = kind == curve_kind::generic
+                ? -expm1(-weight_ratio * log1p(amount_in_with_fee / reserve_in))
+                : detail::curve_decay(kind, weight_ratio, reserve_in / sum, amount_in_with_fee / sum);
+
+            curve_point point;
+            point.amount_out = reserve_out * decay;
+            point.derivative = reserve_out * weight_ratio * fee_factor * (1 - decay) / sum;
+            point.second_derivative = -point.derivative * (weight_ratio + 1) * fee_factor / sum;
+            return point;
+        }
+
+        /**
+         * Single curve evaluation estimate of `get_amount_in` (rounded up, may be a unit off at extreme ratios, see
+         * `amount_in_exact`)
+         */
+        template <typename Check = checked>
+        uint64_t amount_in( const uint64_t amount_out ) const
+        {
+            Check::check(amount_out > 0, "SX.Balancer: INSUFFICIENT_OUTPUT_AMOUNT");
+            Check::check(amount_out < reserve_out, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            return detail::amount_in_curve(inverse_kind, inverse_ratio, amount_out, reserve_in, reserve_out, fee);
+        }
+
+        /**
+         * Smallest input amount whose `get_amount_out` covers `amount_out`, identical to `get_amount_in`
+         *
+         * The rounded-up inverse from the cached curve is returned directly, with at most one confirming forward evaluation
+         * (see `get_amount_in` for the searched cases)
+         */
+        template <typename Check = checked>
+        uint64_t amount_in_exact( const uint64_t amount_out ) const
+        {
+            Check::check(amount_out > 0, "SX.Balancer: INSUFFICIENT_OUTPUT_AMOUNT");
+            Check::check(amount_out < reserve_out, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            return detail::amount_in_weighted<Check>(kind, inverse_kind, inverse_ratio, amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee);
+        }
+
+        /**
+         * Input amount for a fractional `amount_out`, without rounding up
+         */
+        template <typename Check = checked>
+        double amount_in_precise( const double amount_out ) const
+        {
+            Check::check(amount_out > 0, "SX.Balancer: INSUFFICIENT_OUTPUT_AMOUNT");
+            Check::check(amount_out < reserve_out, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+
+            // reserve_in * ((reserve_out / (reserve_out - amount_out)) ^ inverse_ratio - 1) / (1 - fee)
+            const double growth = detail::curve_growth(inverse_kind, inverse_ratio, amount_out / (reserve_out - amount_out));
+            return reserve_in * growth / fee_factor;
+        }
+
+        /**
+         * Equivalent amount of the output asset for `amount_a` of the input asset (see `quote`)
+         */
+        template <typename Check = checked>
+        uint64_t quote( const uint64_t amount_a ) const
+        {
+            Check::check(amount_a > 0, "SX.Balancer: INSUFFICIENT_AMOUNT");
+            return detail::quote_weighted<Check>(amount_a, weighted_reserve_in, weighted_reserve_out);
+        }
+
+        /**
+         * Marginal output per input after fee, fixed-point (18 decimals)
+         */
+        uint128 spot_price_with_fee() const
+        {
+            return spot_price * (10000 - fee) / 10000;
+        }
+
+        /**
+         * Price impact of `amount_in`, `1 - (amount_out / amount_in) / spot_price_with_fee`, fixed-point (18 decimals)
+         */
+        template <typename Check = checked>
+        uint128 price_impact( const uint64_t amount_in ) const
+        {
+            return prices<Check>(amount_in).price_impact;
+        }
+
+        /**
+         * Output amount, quote, spot prices and price impact of `amount_in` from a single curve evaluation
+         */
+        template <typename Check = checked>
+        pool_prices prices( const uint64_t amount_in ) const
+        {
+            Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+
+            const double precise_out = amount_out_precise<Check>(amount_in);
+            const double marginal = static_cast<double>(spot_price) * fee_factor;
+            const double impact = 1 - precise_out * static_cast<double>(BONE) / (amount_in * marginal);
+
+            pool_prices result;
+            result.amount_out = kind == curve_kind::generic ? static_cast<uint64_t>(precise_out) : detail::amount_out_closed_form(kind, amount_in, reserve_in, reserve_out, fee);
+            result.quote = quote<Check>(amount_in);
+            result.spot_price = spot_price;
+            result.spot_price_with_fee = spot_price_with_fee();
+            result.price_impact = impact > 0 ? static_cast<uint128>(impact * static_cast<double>(BONE)) : 0;
+            return result;
+        }
+
+        /**
+         * Apply a trade to the reserves, only the reserve dependent terms are refreshed
+         */
+        void apply_swap( const uint64_t amount_in, const uint64_t amount_out )
+        {
+            eosio::check(amount_out < reserve_out, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            reserve_in = safemath::add(reserve_in, amount_in);
+            reserve_out -= amount_out;
+            update_reserves(amount_in > 0, amount_out > 0);
+        }
+
+        /**
+         * Apply a deposit to the reserves (either amount may be zero for a single-asset join), terms of an unchanged reserve are kept
+         */
+        void apply_join( const uint64_t amount_in, const uint64_t amount_out )
+        {
+            reserve_in = safemath::add(reserve_in, amount_in);
+            reserve_out = safemath::add(reserve_out, amount_out);
+            update_reserves(amount_in > 0, amount_out > 0);
+        }
+
+        /**
+         * Apply a withdrawal from the reserves (either amount may be zero for a single-asset exit), terms of an unchanged reserve are kept
+         */
+        void apply_exit( const uint64_t amount_in, const uint64_t amount_out )
+        {
+            eosio::check(amount_in < reserve_in && amount_out < reserve_out, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            reserve_in -= amount_in;
+            reserve_out -= amount_out;
+            update_reserves(amount_in > 0, amount_out > 0);
+        }
+
+    private:
+        void update_reserves( const bool in = true, const bool out = true )
+        {
+            if ( in ) {
+                reserve_in_scaled = static_cast<double>(reserve_in) * 10000;
+                weighted_reserve_in = static_cast<uint128>(reserve_in) * 10000 / reserve_weight_in;
+            }
+            if ( out ) {
+                weighted_reserve_out = static_cast<uint128>(reserve_out) * 10000 / reserve_weight_out;
+            }
+            if ( in || out ) {
+                spot_price = bratio(static_cast<uint128>(reserve_out) * reserve_weight_in, static_cast<uint128>(reserve_in) * reserve_weight_out);
+            }
+        }
+    };
+
+    /**
+     * ## STATIC `get_amounts_out`
+     *
+     * Given an input amount and a route of pools, returns every intermediate amount in a single pass
+     *
+     * Each pool is oriented along the route (`reserve_in` is the hop input), intermediate amounts are kept in full
+     * double precision between hops and only the final amount is truncated
+     *
+     * ### params
+     *
+     * - `{const pool*} path` - pools along the route
+     * - `{size_t} hops` - number of pools
+     * - `{uint64_t} amount_in` - amount input
+     * - `{double*} amounts` - amounts along the route (caller buffer of `hops + 1` elements, `amounts[0] = amount_in`)
+     *
+     * ### returns
+     *
+     * - `{uint64_t}` - output amount of the last pool
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const balancer::pool path[] = { balancer::pool( 100000000, 50, 400000000, 50 ), balancer::pool( 833515447, 20, 10395237882, 80 ) };
+     *
+     * // Calculation
+     * double amounts[3];
+     * const uint64_t amount_out = balancer::get_amounts_out( path, 2, 10000, amounts );
+     * // => 123952 (amounts => [ 10000, 39876.024360, 123952.375013 ])
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t get_amounts_out( const pool* path, const size_t hops, const uint64_t amount_in, double* amounts )
+    {
+        Check::check(hops > 0, "SX.Balancer: INVALID_PATH");
+
+        amounts[0] = amount_in;
+        for ( size_t i = 0; i < hops; ++i ) {
+            amounts[i + 1] = path[i].amount_out_precise(amounts[i]);
+        }
+        return amounts[hops];
+    }
+
+    /**
+     * ## STATIC `get_amounts_in`
+     *
+     * Given an output amount and a route of pools, returns every required intermediate amount in a single backward pass
+     *
+     * Each pool is oriented along the route (`reserve_in` is the hop input), intermediate amounts are kept in full
+     * double precision between hops and only the first amount is rounded up
+     *
+     * ### params
+     *
+     * - `{const pool*} path` - pools along the route
+     * - `{size_t} hops` - number of pools
+     * - `{uint64_t} amount_out` - amount output
+     * - `{double*} amounts` - amounts along the route (caller buffer of `hops + 1` elements, `amounts[hops] = amount_out`)
+     *
+     * ### returns
+     *
+     * - `{uint64_t}` - input amount of the first pool
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const balancer::pool path[] = { balancer::pool( 100000000, 50, 400000000, 50 ), balancer::pool( 833515447, 20, 10395237882, 80 ) };
+     *
+     * // Calculation
+     * double amounts[3];
+     * const uint64_t amount_in = balancer::get_amounts_in( path, 2, 123952, amounts );
+     * // => 10000 (amounts => [ 9999.969742, 39875.903714, 123952 ])
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t get_amounts_in( const pool* path, const size_t hops, const uint64_t amount_out, double* amounts )
+    {
+        Check::check(hops > 0, "SX.Balancer: INVALID_PATH");
+
+        amounts[hops] = amount_out;
+        for ( size_t i = hops; i > 0; --i ) {
+            amounts[i - 1] = path[i - 1].amount_in_precise(amounts[i]);
+        }
+        return ceil(amounts[0]);
+    }
+
+    /**
+     * ## STATIC `get_amounts_in_exact`
+     *
+     * Given an exact output amount and a route of pools, returns every required intermediate amount in a single backward pass,
+     * running the result forward through `get_amount_out` hop by hop yields at least `amount_out`
+     *
+     * Each hop uses `pool.amount_in_exact` (cached rounded-up inverse, at most one forward evaluation), forward coverage
+     * carries through the route because `get_amount_out` is non-decreasing in `amount_in`
+     *
+     * ### params
+     *
+     * - `{const pool*} path` - pools along the route
+     * - `{size_t} hops` - number of pools
+     * - `{uint64_t} amount_out` - exact amount output
+     * - `{uint64_t*} amounts` - integer amounts along the route (caller buffer of `hops + 1` elements, `amounts[hops] = amount_out`)
+     *
+     * ### returns
+     *
+     * - `{uint64_t}` - input amount of the first pool
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const balancer::pool path[] = { balancer::pool( 100000000, 50, 400000000, 50 ), balancer::pool( 833515447, 20, 10395237882, 80 ) };
+     *
+     * // Calculation
+     * uint64_t amounts[3];
+     * const uint64_t amount_in = balancer::get_amounts_in_exact( path, 2, 123952, amounts );
+     * // => 10000 (amounts => [ 10000, 39876, 123952 ])
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t get_amounts_in_exact( const pool* path, const size_t hops, const uint64_t amount_out, uint64_t* amounts )
+    {
+        Check::check(hops > 0, "SX.Balancer: INVALID_PATH");
+
+        amounts[hops] = amount_out;
+        for ( size_t i = hops; i > 0; --i ) {
+            amounts[i - 1] = path[i - 1].amount_in_exact<Check>(amounts[i]);
+        }
+        return amounts[0];
+    }
+
+    /**
+     * ## STATIC `get_optimal_amount_in`
+     *
+     * Given two pools trading the same pair in opposite directions, returns the input amount that maximizes
+     * the arbitrage profit `pool_b.amount_out( pool_a.amount_out( amount_in ) ) - amount_in`
+     *
+     * Equal-weight pools use the constant-product closed form, other weights run Newton's method on the analytic
+     * derivative of the composed curve (monotone convergence from zero, a handful of iterations)
+     *
+     * ### params
+     *
+     * - `{pool} pool_a` - first hop (token A in, token B out)
+     * - `{pool} pool_b` - second hop (token B in, token A out)
+     * - `{uint32_t} [max_iterations=32]` - (optional) maximum Newton iterations
+     *
+     * ### returns
+     *
+     * - `{uint64_t}` - optimal input amount, `0` when there is no profitable trade
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const balancer::pool pool_a( 100000000, 50, 400000000, 50 );
+     * const balancer::pool pool_b( 300000000, 80, 100000000, 20 );
+     *
+     * // Calculation
+     * const uint64_t amount_in = balancer::get_optimal_amount_in( pool_a, pool_b );
+     * // => 25949358
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t get_optimal_amount_in( const pool& pool_a, const pool& pool_b, const uint32_t max_iterations = 32 )
+    {
+        double amount_in = 0;
+
+        if ( pool_a.kind == curve_kind::pow_1 && pool_b.kind == curve_kind::pow_1 ) {
+            // composed constant product: out = k * a / (b + c * a), optimum at (sqrt(k * b) - b) / c
+            const double k = pool_a.fee_factor * pool_b.fee_factor * pool_a.reserve_out * pool_b.reserve_out;
+            const double b = static_cast<double>(pool_a.reserve_in) * pool_b.reserve_in;
+            const double c = pool_a.fee_factor * (pool_b.reserve_in + pool_b.fee_factor * pool_a.reserve_out);
+            if ( k > b ) amount_in = (sqrt(k) * sqrt(b) - b) / c;
+        } else {
+            // Newton's method on profit'(a) = pool_b'(pool_a(a)) * pool_a'(a) - 1
+            for ( uint32_t i = 0; i < max_iterations; ++i ) {
+                const curve_point a = pool_a.curve_at(amount_in);
+                const curve_point b = pool_b.curve_at(a.amount_out);
+                const double gradient = b.derivative * a.derivative - 1;
+                const double curvature = b.second_derivative * a.derivative * a.derivative + b.derivative * a.second_derivative;
+                if ( i == 0 && gradient <= 0 ) break;
+
+                const double step = -gradient / curvature;
+                amount_in += step;
+                if ( !(amount_in > 0) || fabs(step) < 0.5 ) break;
+            }
+        }
+        if ( amount_in < 1 ) return 0;
+
+        const uint64_t optimal = amount_in;
+        const uint64_t amount_out = pool_b.amount_out(pool_a.amount_out(optimal));
+        return amount_out > optimal ? optimal : 0;
+    }
+
+    /**
+     * ## STATIC `sample_curve`
+     *
+     * Given a pool and a ladder of input amounts, writes the output amount of every rung (price-depth ladder)
+     *
+     * Rungs are evaluated against the cached pool terms (weight ratio, fee factor), each output is
+     * identical to `pool.amount_out( amount_in )`, no allocation
+     *
+     * ### params
+     *
+     * - `{pool} pool` - pool
+     * - `{const uint64_t*} amounts_in` - amounts input
+     * - `{uint64_t*} amounts_out` - amounts output (caller buffer of `count` elements)
+     * - `{size_t} count` - number of rungs
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const balancer::pool pool( 833515447, 40, 10395237882, 60 );
+     * const uint64_t amounts_in[] = { 10000, 100000, 1000000 };
+     *
+     * // Calculation
+     * uint64_t amounts_out[3];
+     * balancer::sample_curve( pool, amounts_in, amounts_out, 3 );
+     * // => [ 82893, 828860, 8281176 ]
+     * ```
+     */
+    template <typename Check = checked>
+    static void sample_curve( const pool& pool, const uint64_t* amounts_in, uint64_t* amounts_out, const size_t count )
+    {
+        for ( size_t i = 0; i < count; ++i ) {
+            Check::check(amounts_in[i] > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+            amounts_out[i] = pool.amount_out<unchecked>(amounts_in[i]);
+        }
+    }
+
+    /**
+     * ## STATIC `sample_curve_geometric`
+     *
+     * Given a pool and an input range, writes a geometric ladder of `count` input amounts from `min_amount_in` to `max_amount_in`
+     * and the output amount of every rung (see `sample_curve`)
+     *
+     * Rungs are spaced by a constant factor `(max_amount_in / min_amount_in) ^ (1 / (count - 1))`, rounded to the nearest unit,
+     * the first and last rungs are exactly `min_amount_in` and `max_amount_in`
+     *
+     * ### params
+     *
+     * - `{pool} pool` - pool
+     * - `{uint64_t} min_amount_in` - first rung input amount
+     * - `{uint64_t} max_amount_in` - last rung input amount
+     * - `{uint64_t*} amounts_in` - amounts input (caller buffer of `count` elements)
+     * - `{uint64_t*} amounts_out` - amounts output (caller buffer of `count` elements)
+     * - `{size_t} count` - number of rungs
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const balancer::pool pool( 833515447, 40, 10395237882, 60 );
+     *
+     * // Calculation
+     * uint64_t amounts_in[3];
+     * uint64_t amounts_out[3];
+     * balancer::sample_curve_geometric( pool, 10000, 1000000, amounts_in, amounts_out, 3 );
+     * // => amounts_in [ 10000, 100000, 1000000 ], amounts_out [ 82893, 828860, 8281176 ]
+     * ```
+     */
+    template <typename Check = checked>
+    static void sample_curve_geometric( const pool& pool, const uint64_t min_amount_in, const uint64_t max_amount_in, uint64_t* amounts_in, uint64_t* amounts_out, const size_t count )
+    {
+        Check::check(min_amount_in > 0 && min_amount_in <= max_amount_in, "SX.Balancer: INVALID_RANGE");
+        if ( count == 0 ) return;
+
+        const double step = count > 1 ? pow(static_cast<double>(max_amount_in) / min_amount_in, 1.0 / (count - 1)) : 1;
+        double amount_in = min_amount_in;
+        for ( size_t i = 0; i < count; ++i ) {
+            amounts_in[i] = i == 0 ? min_amount_in : (i == count - 1 ? max_amount_in : static_cast<uint64_t>(amount_in + 0.5));
+            amounts_out[i] = pool.amount_out<unchecked>(amounts_in[i]);
+            amount_in *= step;
+        }
+    }
+
+    namespace detail {
+        /**
+         * `1 - (1 - weight / total_weight) * fee`, the swap fee charged on the non-proportional part of a single-asset join / exit
+         */
+        static inline double single_fee_factor( const uint64_t weight, const uint64_t total_weight, const uint8_t fee )
+        {
+            return 1 - static_cast<double>(total_weight - weight) * fee / (static_cast<double>(total_weight) * 10000);
+        }
+    }
+
+    /**
+     * ## STATIC `pool_out_given_single_in`
+     *
+     * Given an input amount of a single asset, returns the pool tokens minted by the join
+     *
+     * `pool_supply * ((1 + amount_in_after_fee / balance_in) ^ (weight_in / total_weight) - 1)`, the fee only applies to the
+     * `1 - weight_in / total_weight` share of the input that is implicitly swapped into the other assets
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} balance_in` - pool balance of the input asset
+     * - `{uint64_t} weight_in` - input asset weight
+     * - `{uint64_t} pool_supply` - pool token supply
+     * - `{uint64_t} total_weight` - sum of the pool weights
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t pool_out = balancer::pool_out_given_single_in( 10000000, 100000000, 20, 1000000000, 80 );
+     * // => 24061315
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t pool_out_given_single_in( const uint64_t amount_in, const uint64_t balance_in, const uint64_t weight_in, const uint64_t pool_supply, const uint64_t total_weight, const uint8_t fee = 30 )
+    {
+        // checks
+        Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+        Check::check(balance_in > 0 && pool_supply > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(weight_in > 0 && weight_in <= total_weight, "SX.Balancer: INVALID_WEIGHT");
+
+        // calculations
+        const curve_kind kind = get_curve_kind(weight_in, total_weight);
+        const double normalized_weight = static_cast<double>(weight_in) / total_weight;
+        const double amount_in_after_fee = amount_in * detail::single_fee_factor(weight_in, total_weight, fee);
+        const double pool_out = pool_supply * detail::curve_growth(kind, normalized_weight, amount_in_after_fee / balance_in);
+        Check::check(pool_out < 18446744073709551616.0, "SX.Balancer: OVERFLOW");
+
+        return pool_out;
+    }
+
+    /**
+     * ## STATIC `single_in_given_pool_out`
+     *
+     * Given an amount of pool tokens to mint, returns the required input amount of a single asset (inverse of `pool_out_given_single_in`)
+     *
+     * `balance_in * ((1 + pool_out / pool_supply) ^ (total_weight / weight_in) - 1) / (1 - (1 - weight_in / total_weight) * fee)`, rounded up
+     *
+     * ### params
+     *
+     * - `{uint64_t} pool_out` - pool tokens output
+     * - `{uint64_t} balance_in` - pool balance of the input asset
+     * - `{uint64_t} weight_in` - input asset weight
+     * - `{uint64_t} pool_supply` - pool token supply
+     * - `{uint64_t} total_weight` - sum of the pool weights
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t amount_in = balancer::single_in_given_pool_out( 24061315, 100000000, 20, 1000000000, 80 );
+     * // => 10000000
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t single_in_given_pool_out( const uint64_t pool_out, const uint64_t balance_in, const uint64_t weight_in, const uint64_t pool_supply, const uint64_t total_weight, const uint8_t fee = 30 )
+    {
+        // checks
+        Check::check(pool_out > 0, "SX.Balancer: INSUFFICIENT_OUTPUT_AMOUNT");
+        Check::check(balance_in > 0 && pool_supply > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(weight_in > 0 && weight_in <= total_weight, "SX.Balancer: INVALID_WEIGHT");
+
+        // calculations
+        const curve_kind kind = get_curve_kind(total_weight, weight_in);
+        const double inverse_weight = static_cast<double>(total_weight) / weight_in;
+        const double growth = detail::curve_growth(kind, inverse_weight, static_cast<double>(pool_out) / pool_supply);
+        const double amount_in = balance_in * growth / detail::single_fee_factor(weight_in, total_weight, fee);
+        Check::check(amount_in < 18446744073709551616.0, "SX.Balancer: OVERFLOW");
+
+        return 1 + amount_in;
+    }
+
+    /**
+     * ## STATIC `single_out_given_pool_in`
+     *
+     * Given an amount of pool tokens to burn, returns the output amount of a single asset
+     *
+     * `balance_out * (1 - (1 - pool_in_after_exit_fee / pool_supply) ^ (total_weight / weight_out)) * (1 - (1 - weight_out / total_weight) * fee)`
+     *
+     * ### params
+     *
+     * - `{uint64_t} pool_in` - pool tokens input
+     * - `{uint64_t} balance_out` - pool balance of the output asset
+     * - `{uint64_t} weight_out` - output asset weight
+     * - `{uint64_t} pool_supply` - pool token supply
+     * - `{uint64_t} total_weight` - sum of the pool weights
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     * - `{uint8_t} [exit_fee=0]` - (optional) exit fee on the burned pool tokens (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t amount_out = balancer::single_out_given_pool_in( 10000000, 100000000, 20, 1000000000, 80 );
+     * // => 3931533
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t single_out_given_pool_in( const uint64_t pool_in, const uint64_t balance_out, const uint64_t weight_out, const uint64_t pool_supply, const uint64_t total_weight, const uint8_t fee = 30, const uint8_t exit_fee = 0 )
+    {
+        // checks
+        Check::check(pool_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+        Check::check(balance_out > 0 && pool_supply > pool_in, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(weight_out > 0 && weight_out <= total_weight, "SX.Balancer: INVALID_WEIGHT");
+
+        // calculations
+        const curve_kind kind = get_curve_kind(total_weight, weight_out);
+        const double inverse_weight = static_cast<double>(total_weight) / weight_out;
+        const double d = pool_in * (1 - static_cast<double>(exit_fee) / 10000) / pool_supply;
+        const double amount_out_before_fee = balance_out * detail::curve_decay(kind, inverse_weight, 1 - d, d);
+        const uint64_t amount_out = amount_out_before_fee * detail::single_fee_factor(weight_out, total_weight, fee);
+
+        return amount_out;
+    }
+
+    /**
+     * ## STATIC `pool_in_given_single_out`
+     *
+     * Given an output amount of a single asset, returns the pool tokens to burn (inverse of `single_out_given_pool_in`)
+     *
+     * `pool_supply * (1 - (1 - amount_out_before_fee / balance_out) ^ (weight_out / total_weight)) / (1 - exit_fee)`, rounded up
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_out` - amount output
+     * - `{uint64_t} balance_out` - pool balance of the output asset
+     * - `{uint64_t} weight_out` - output asset weight
+     * - `{uint64_t} pool_supply` - pool token supply
+     * - `{uint64_t} total_weight` - sum of the pool weights
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     * - `{uint8_t} [exit_fee=0]` - (optional) exit fee on the burned pool tokens (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t pool_in = balancer::pool_in_given_single_out( 3931533, 100000000, 20, 1000000000, 80 );
+     * // => 10000000
+     * ```
+     */
+    template <typename Check = checked>
+    static uint64_t pool_in_given_single_out( const uint64_t amount_out, const uint64_t balance_out, const uint64_t weight_out, const uint64_t pool_supply, const uint64_t total_weight, const uint8_t fee = 30, const uint8_t exit_fee = 0 )
+    {
+        // checks
+        Check::check(amount_out > 0, "SX.Balancer: INSUFFICIENT_OUTPUT_AMOUNT");
+        Check::check(balance_out > amount_out && pool_supply > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        Check::check(weight_out > 0 && weight_out <= total_weight, "SX.Balancer: INVALID_WEIGHT");
+
+        // calculations
+        const curve_kind kind = get_curve_kind(weight_out, total_weight);
+        const double normalized_weight = static_cast<double>(weight_out) / total_weight;
+        const double d = amount_out / detail::single_fee_factor(weight_out, total_weight, fee) / balance_out;
+        Check::check(d < 1, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+        const double pool_in = pool_supply * detail::curve_decay(kind, normalized_weight, 1 - d, d) / (1 - static_cast<double>(exit_fee) / 10000);
+
+        return 1 + pool_in;
+    }
+
+    /**
+     * Maximum number of tokens held by a `multi_pool`
+     */
+    static constexpr size_t MAX_POOL_TOKENS = 8;
+
+    /**
+     * ## STRUCT `multi_pool`
+     *
+     * Precomputed N-asset pool state (up to `MAX_POOL_TOKENS` tokens), built once from balances, weights and fee
+     *
+     * Caches the weight ratio and curve kind of every `(i, j)` pair (weights are fixed) and the weighted balance of every
+     * token (refreshed by the `apply_*` updates), every pair is answered from the shared cache (`pair( i, j )` builds the
+     * equivalent two-asset `pool`)
+     *
+     * ### params
+     *
+     * - `{const uint64_t*} balances` - token balances
+     * - `{const uint64_t*} weights` - token weights
+     * - `{size_t} size` - number of tokens
+     * - `{uint8_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t balances[] = { 45851931234, 125682033533, 833515447 };
+     * const uint64_t weights[] = { 40, 40, 20 };
+     * balancer::multi_pool pool( balances, weights, 3 );
+     *
+     * // Calculation
+     * const uint64_t amount_out = pool.amount_out( 0, 1, 10000 );
+     * // => 27328
+     *
+     * // Simulate trade
+     * pool.apply_swap( 0, 1, 10000, amount_out );
+     * ```
+     */
+    struct multi_pool {
+        size_t size;
+        uint64_t balances[MAX_POOL_TOKENS];
+        uint64_t weights[MAX_POOL_TOKENS];
+        uint64_t total_weight;
+        uint8_t fee;
+
+        // cached terms
+        double fee_factor;                              // 1 - fee / 10000
+        double weight_ratios[MAX_POOL_TOKENS][MAX_POOL_TOKENS];     // weights[i] / weights[j]
+        curve_kind kinds[MAX_POOL_TOKENS][MAX_POOL_TOKENS];         // get_curve_kind( weights[i], weights[j] )
+        uint128 weighted_balances[MAX_POOL_TOKENS];                 // balances[i] * 10000 / weights[i]
+
+        multi_pool( const uint64_t* balances, const uint64_t* weights, const size_t size, const uint8_t fee = 30 )
+            : size( size ),
+              total_weight( 0 ),
+              fee( fee )
+        {
+            // checks
+            eosio::check(size >= 2 && size <= MAX_POOL_TOKENS, "SX.Balancer: INVALID_SIZE");
+
+            for ( size_t i = 0; i < size; ++i ) {
+                eosio::check(balances[i] > 0, "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+                eosio::check(weights[i] > 0, "SX.Balancer: INVALID_WEIGHT");
+                this->balances[i] = balances[i];
+                this->weights[i] = weights[i];
+                total_weight = safemath::add(total_weight, weights[i]);
+                update_balance(i);
+            }
+            for ( size_t i = 0; i < size; ++i ) {
+                for ( size_t j = 0; j < size; ++j ) {
+                    weight_ratios[i][j] = static_cast<double>(weights[i]) / weights[j];
+                    kinds[i][j] = get_curve_kind(weights[i], weights[j]);
+                }
+            }
+            fee_factor = 1 - static_cast<double>(fee) / 10000;
+        }
+
+        /**
+         * Maximum output amount of token `j` for `amount_in` of token `i` (see `get_amount_out`)
+         */
+        template <typename Check = checked>
+        uint64_t amount_out( const size_t i, const size_t j, const uint64_t amount_in ) const
+        {
+            check_pair<Check>(i, j);
+            Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+
+            const curve_kind kind = kinds[i][j];
+            if ( kind != curve_kind::generic ) return detail::amount_out_closed_form(kind, amount_in, balances[i], balances[j], fee);
+            return amount_out_precise<Check>(i, j, amount_in);
+        }
+
+        /**
+         * Output amount of token `j` for a fractional `amount_in` of token `i`, without truncation
+         */
+        template <typename Check = checked>
+        double amount_out_precise( const size_t i, const size_t j, const double amount_in ) const
+        {
+            check_pair<Check>(i, j);
+            Check::check(amount_in > 0, "SX.Balancer: INSUFFICIENT_INPUT_AMOUNT");
+
+            // 1 - (balance_i / (balance_i + amount_in_with_fee)) ^ (weight_i / weight_j)
+            const curve_kind kind = kinds[i][j];
+            const double weight_ratio = weight_ratios[i][j];
+            const double amount_in_with_fee = amount_in * fee_factor;
+            if ( kind == curve_kind::generic ) {
+                return balances[j] * -expm1(-weight_ratio * log1p(amount_in_with_fee / balances[i]));
+            }
+            const double sum = balances[i] + amount_in_with_fee;
+            return balances[j] * detail::curve_decay(kind, weight_ratio, balances[i] / sum, amount_in_with_fee / sum);
+        }
+
+        /**
+         * Required input amount of token `i` for `amount_out` of token `j` (see `get_amount_in`)
+         */
+        template <typename Check = checked>
+        uint64_t amount_in( const size_t i, const size_t j, const uint64_t amount_out ) const
+        {
+            check_pair<Check>(i, j);
+            Check::check(amount_out > 0, "SX.Balancer: INSUFFICIENT_OUTPUT_AMOUNT");
+            Check::check(amount_out < balances[j], "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+
+            return detail::amount_in_curve(kinds[j][i], weight_ratios[j][i], amount_out, balances[i], balances[j], fee);
+        }
+
+        /**
+         * Equivalent amount of token `j` for `amount_a` of token `i` (see `quote`)
+         */
+        template <typename Check = checked>
+        uint64_t quote( const size_t i, const size_t j, const uint64_t amount_a ) const
+        {
+            check_pair<Check>(i, j);
+            Check::check(amount_a > 0, "SX.Balancer: INSUFFICIENT_AMOUNT");
+            return detail::quote_weighted<Check>(amount_a, weighted_balances[i], weighted_balances[j]);
+        }
+
+        /**
+         * Marginal output of token `j` per input of token `i`, `(balance_j / weight_j) / (balance_i / weight_i)`, fixed-point (18 decimals)
+         */
+        template <typename Check = checked>
+        uint128 spot_price( const size_t i, const size_t j ) const
+        {
+            check_pair<Check>(i, j);
+            return bratio(static_cast<uint128>(balances[j]) * weights[i], static_cast<uint128>(balances[i]) * weights[j]);
+        }
+
+        /**
+         * Marginal output of token `j` per input of token `i` after fee, fixed-point (18 decimals)
+         */
+        template <typename Check = checked>
+        uint128 spot_price_with_fee( const size_t i, const size_t j ) const
+        {
+            return spot_price<Check>(i, j) * (10000 - fee) / 10000;
+        }
+
+        /**
+         * Pool tokens minted by a join of `amount_in` of token `i` (see `pool_out_given_single_in`)
+         */
+        template <typename Check = checked>
+        uint64_t pool_out_given_single_in( const size_t i, const uint64_t amount_in, const uint64_t pool_supply ) const
+        {
+            check_token<Check>(i);
+            return balancer::pool_out_given_single_in<Check>(amount_in, balances[i], weights[i], pool_supply, total_weight, fee);
+        }
+
+        /**
+         * Input amount of token `i` to mint `pool_out` pool tokens (see `single_in_given_pool_out`)
+         */
+        template <typename Check = checked>
+        uint64_t single_in_given_pool_out( const size_t i, const uint64_t pool_out, const uint64_t pool_supply ) const
+        {
+            check_token<Check>(i);
+            return balancer::single_in_given_pool_out<Check>(pool_out, balances[i], weights[i], pool_supply, total_weight, fee);
+        }
+
+        /**
+         * Output amount of token `i` for burning `pool_in` pool tokens (see `single_out_given_pool_in`)
+         */
+        template <typename Check = checked>
+        uint64_t single_out_given_pool_in( const size_t i, const uint64_t pool_in, const uint64_t pool_supply, const uint8_t exit_fee = 0 ) const
+        {
+            check_token<Check>(i);
+            return balancer::single_out_given_pool_in<Check>(pool_in, balances[i], weights[i], pool_supply, total_weight, fee, exit_fee);
+        }
+
+        /**
+         * Pool tokens to burn for `amount_out` of token `i` (see `pool_in_given_single_out`)
+         */
+        template <typename Check = checked>
+        uint64_t pool_in_given_single_out( const size_t i, const uint64_t amount_out, const uint64_t pool_supply, const uint8_t exit_fee = 0 ) const
+        {
+            check_token<Check>(i);
+            return balancer::pool_in_given_single_out<Check>(amount_out, balances[i], weights[i], pool_supply, total_weight, fee, exit_fee);
+        }
+
+        /**
+         * Two-asset `pool` trading token `i` for token `j`
+         */
+        pool pair( const size_t i, const size_t j ) const
+        {
+            check_pair<checked>(i, j);
+            return pool(balances[i], weights[i], balances[j], weights[j], fee);
+        }
+
+        /**
+         * Apply a trade of token `i` for token `j` to the balances, only the two traded tokens are refreshed
+         */
+        void apply_swap( const size_t i, const size_t j, const uint64_t amount_in, const uint64_t amount_out )
+        {
+            check_pair<checked>(i, j);
+            eosio::check(amount_out < balances[j], "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            balances[i] = safemath::add(balances[i], amount_in);
+            balances[j] -= amount_out;
+            update_balance(i);
+            update_balance(j);
+        }
+
+        /**
+         * Apply a single-asset deposit of token `i`, only that token is refreshed
+         */
+        void apply_join( const size_t i, const uint64_t amount_in )
+        {
+            check_token<checked>(i);
+            balances[i] = safemath::add(balances[i], amount_in);
+            update_balance(i);
+        }
+
+        /**
+         * Apply a single-asset withdrawal of token `i`, only that token is refreshed
+         */
+        void apply_exit( const size_t i, const uint64_t amount_out )
+        {
+            check_token<checked>(i);
+            eosio::check(amount_out < balances[i], "SX.Balancer: INSUFFICIENT_LIQUIDITY");
+            balances[i] -= amount_out;
+            update_balance(i);
+        }
+
+    private:
+        template <typename Check>
+        void check_token( const size_t i ) const
+        {
+            Check::check(i < size, "SX.Balancer: INVALID_TOKEN");
+        }
+
+        template <typename Check>
+        void check_pair( const size_t i, const size_t j ) const
+        {
+            Check::check(i < size && j < size && i != j, "SX.Balancer: INVALID_TOKEN");
+        }
+
+        void update_balance( const size_t i )
+        {
+            weighted_balances[i] = static_cast<uint128>(balances[i]) * 10000 / weights[i];
+        }
+    };
 }
\ No newline at end of file
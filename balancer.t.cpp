@@ -4,7 +4,22 @@
 #include <eosio/check.hpp>
 #include <uint128_t/uint128_t.cpp>
 
+#include <random>
+#include <string>
+
 #include "balancer.hpp"
+#include "balancer.engine.hpp"
+
+// reference of the host paths (`pool`, tables, batches, engines), they stay on the double curve under the on-chain
+// profile while `get_amount_out` switches to `bpow` (see "on-chain profile (pass)")
+static uint64_t host_amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_weight_in, const uint64_t reserve_out, const uint64_t reserve_weight_out, const uint8_t fee = 30 )
+{
+#if defined(BALANCER_FIXED_POINT)
+    return balancer::pool( reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee ).amount_out( amount_in );
+#else
+    return balancer::get_amount_out( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out, fee );
+#endif
+}
 
 TEST_CASE( "get_amount_out #1 (pass)" ) {
     // Inputs
@@ -46,6 +61,10 @@ TEST_CASE( "get_amount_in (pass)" ) {
     const uint64_t amountIn = balancer::get_amount_in( amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
 
     REQUIRE( amountIn == 10000 );
+
+    // exact division, the rounded-up inverse is the forward input itself
+    REQUIRE( balancer::get_amount_out( 10000, 9970, 50, 20000, 50 ) == 10000 );
+    REQUIRE( balancer::get_amount_in( 10000, 9970, 50, 20000, 50 ) == 10000 );
 }
 
 TEST_CASE( "quote (pass)" ) {
@@ -60,4 +79,1100 @@ TEST_CASE( "quote (pass)" ) {
     const uint64_t amount_b = balancer::quote( amount_a, reserve_a, reserve_weight_a, reserve_b, reserve_weight_b );
 
     REQUIRE( amount_b == 40000 );
-}
\ No newline at end of file
+}
+
+TEST_CASE( "get_amount_out_batch (pass)" ) {
+    // Inputs
+    const uint64_t amounts_in[] = { 10000, 100000 };
+    const uint64_t reserve_in = 833515447;
+    const uint64_t reserve_out = 10395237882;
+    const uint64_t reserve_weight_in = 20;
+    const uint64_t reserve_weight_out = 80;
+
+    // Calculation
+    uint64_t amounts_out[2];
+    balancer::get_amount_out_batch( amounts_in, amounts_out, 2, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
+
+    REQUIRE( amounts_out[0] == host_amount_out( amounts_in[0], reserve_in, reserve_weight_in, reserve_out, reserve_weight_out ) );
+    REQUIRE( amounts_out[1] == 310830 );
+}
+
+TEST_CASE( "pool (pass)" ) {
+    // Inputs
+    const balancer::pool pool_50_50( 100000000, 500000, 400000000, 500000 );
+    const balancer::pool pool_20_80( 833515447, 20, 10395237882, 80 );
+
+    // Calculation
+    REQUIRE( pool_50_50.amount_out( 10000 ) == 39876 );
+    REQUIRE( pool_20_80.amount_out( 100000 ) == 310830 );
+    REQUIRE( pool_50_50.amount_in( 39876 ) == 10000 );
+    REQUIRE( pool_50_50.quote( 10000 ) == 40000 );
+}
+
+TEST_CASE( "pool apply_swap (pass)" ) {
+    // Inputs
+    balancer::pool pool( 100000000, 500000, 400000000, 500000 );
+
+    // Calculation
+    const uint64_t amount_out = pool.amount_out( 10000 );
+    pool.apply_swap( 10000, amount_out );
+
+    REQUIRE( pool.reserve_in == 100010000 );
+    REQUIRE( pool.reserve_out == 400000000 - amount_out );
+    REQUIRE( pool.amount_out( 10000 ) == host_amount_out( 10000, pool.reserve_in, 500000, pool.reserve_out, 500000 ) );
+}
+
+TEST_CASE( "pool large reserves small trade (pass)" ) {
+    // Inputs, cached terms must not cancel against `reserve_in`
+    const balancer::pool pool( 1000000000000000, 40, 10000000000000000000ULL, 60 );
+
+    // Calculation, exact curve 6646666.67 / 664666666.61 / 66466666114.44
+    REQUIRE( pool.amount_out( 1000 ) == 6646666 );
+    REQUIRE( pool.amount_out( 100000 ) == 664666666 );
+    REQUIRE( pool.amount_out( 10000000 ) == 66466666114 );
+    for ( uint64_t amount_in = 1000; amount_in < 1000000000000; amount_in = amount_in * 7 + 1 ) {
+        REQUIRE( pool.amount_out( amount_in ) == host_amount_out( amount_in, 1000000000000000, 40, 10000000000000000000ULL, 60 ) );
+        REQUIRE( pool.curve_at( amount_in ).amount_out == Approx( pool.amount_out_precise( amount_in ) ).epsilon( 1e-15 ) );
+    }
+}
+
+TEST_CASE( "get_amount_out_soa (pass)" ) {
+    // Inputs
+    const uint64_t amounts_in[] = { 10000, 100000, 10000 };
+    const uint64_t reserves_in[] = { 100000000, 833515447, 45851931234 };
+    const uint64_t reserve_weights_in[] = { 500000, 20, 50000 };
+    const uint64_t reserves_out[] = { 400000000, 10395237882, 125682033533 };
+    const uint64_t reserve_weights_out[] = { 500000, 80, 50000 };
+    const uint8_t fees[] = { 30, 30, 30 };
+
+    // Calculation
+    uint64_t amounts_out[3];
+    balancer::get_amount_out_soa( amounts_in, amounts_out, 3, reserves_in, reserve_weights_in, reserves_out, reserve_weights_out, fees );
+
+    REQUIRE( amounts_out[0] == 39876 );
+    REQUIRE( amounts_out[1] == 310830 );
+    REQUIRE( amounts_out[2] == 27328 );
+
+    // deep pool, small trade (exact curve 6646666.67)
+    const uint64_t deep_in = 1000000000000000;
+    const uint64_t deep_out = 10000000000000000000ULL;
+    const uint64_t weight_in = 40;
+    const uint64_t weight_out = 60;
+    const uint8_t fee = 30;
+    uint64_t amount = 1000;
+    balancer::get_amount_out_soa<balancer::unchecked>( &amount, &amount, 1, &deep_in, &weight_in, &deep_out, &weight_out, &fee );
+    REQUIRE( amount == balancer::get_amount_out( 1000, deep_in, weight_in, deep_out, weight_out, fee ) );
+#if !defined(BALANCER_FIXED_POINT)
+    REQUIRE( amount == 6646666 );
+#endif
+
+    // random deep pools, every lane identical to `get_amount_out` (closed forms, 50/50 and generic weights)
+    const size_t count = 4096;
+    std::mt19937_64 rng( 3 );
+    std::uniform_real_distribution<double> reserve_exp( 3, 19 );
+    std::uniform_real_distribution<double> trade_exp( -9, -0.31 );
+    std::vector<uint64_t> lanes_in( count ), lanes_out( count ), lane_reserves_in( count ), lane_weights_in( count ), lane_reserves_out( count ), lane_weights_out( count );
+    std::vector<uint8_t> lane_fees( count );
+    for ( size_t i = 0; i < count; ++i ) {
+        lane_reserves_in[i] = std::min( 1e19, pow( 10, reserve_exp( rng ) ) );
+        lane_reserves_out[i] = std::min( 1e19, pow( 10, reserve_exp( rng ) ) );
+        lane_weights_in[i] = i % 3 == 0 ? 50 : 1 + rng() % 99;
+        lane_weights_out[i] = i % 3 == 0 ? 50 : i % 3 == 1 ? lane_weights_in[i] * ( 1 + rng() % 4 ) : 1 + rng() % 99;
+        lane_fees[i] = rng() % 100;
+        lanes_in[i] = 1 + static_cast<uint64_t>( lane_reserves_in[i] * pow( 10, trade_exp( rng ) ) );     // within MAX_IN_RATIO
+    }
+    balancer::get_amount_out_soa( lanes_in.data(), lanes_out.data(), count, lane_reserves_in.data(), lane_weights_in.data(), lane_reserves_out.data(), lane_weights_out.data(), lane_fees.data() );
+    for ( size_t i = 0; i < count; ++i ) {
+        REQUIRE( lanes_out[i] == balancer::get_amount_out( lanes_in[i], lane_reserves_in[i], lane_weights_in[i], lane_reserves_out[i], lane_weights_out[i], lane_fees[i] ) );
+    }
+}
+
+TEST_CASE( "pow_batch (pass)" ) {
+    // Inputs
+    const double x[] = { 0.25, 0.5, 1.0, 0.999, 0.3, 1e-300 };
+    const double y[] = { 0.5, 2.0, 0.25, 4.0, 1.0 / 3, 2.0 };
+
+    // Calculation
+    double z[6];
+    balancer::pow_batch( x, y, z, 6 );
+
+    for ( int i = 0; i < 5; ++i ) {
+        REQUIRE( fabs(z[i] - pow(x[i], y[i])) <= 4e-16 * pow(x[i], y[i]) );
+    }
+    REQUIRE( z[5] == 0 );
+}
+
+TEST_CASE( "bpow (pass)" ) {
+    const balancer::uint128 BONE = balancer::BONE;
+
+    REQUIRE( balancer::bpow( BONE / 2, 2 * BONE ) == BONE / 4 );
+    REQUIRE( balancer::bpow( BONE / 4, BONE / 2 ) == 500000000254041274ULL );
+    REQUIRE( balancer::bpow( BONE / 4, BONE / 2, 1 ) == 499999999999999869ULL );
+    REQUIRE( balancer::bpow( BONE / 4, BONE / 2, 1, 4 ) == 515960693359375000ULL );
+}
+
+TEST_CASE( "get_amount_out_fixed (pass)" ) {
+    REQUIRE( balancer::get_amount_out_fixed( 10000, 100000000, 500000, 400000000, 500000 ) == 39876 );
+    REQUIRE( balancer::get_amount_out_fixed( 100000, 833515447, 20, 10395237882, 80 ) == 310830 );
+}
+
+TEST_CASE( "get_curve_kind (pass)" ) {
+    REQUIRE( balancer::get_curve_kind( 500000, 500000 ) == balancer::curve_kind::pow_1 );
+    REQUIRE( balancer::get_curve_kind( 80, 20 ) == balancer::curve_kind::pow_4 );
+    REQUIRE( balancer::get_curve_kind( 20, 80 ) == balancer::curve_kind::root_4 );
+    REQUIRE( balancer::get_curve_kind( 25, 75 ) == balancer::curve_kind::root_3 );
+    REQUIRE( balancer::get_curve_kind( 40, 60 ) == balancer::curve_kind::generic );
+    REQUIRE( balancer::get_curve_kind( UINT64_MAX, UINT64_MAX / 2 + 1 ) == balancer::curve_kind::generic );
+}
+
+TEST_CASE( "get_amount_out<W_IN, W_OUT> (pass)" ) {
+    // Inputs
+    const uint64_t amount_in = 100000;
+    const uint64_t reserve_in = 833515447;
+    const uint64_t reserve_out = 10395237882;
+
+    // Calculation
+    REQUIRE( balancer::get_amount_out<500000, 500000>( 10000, 100000000, 400000000 ) == 39876 );
+    REQUIRE( balancer::get_amount_out<20, 80>( amount_in, reserve_in, reserve_out ) == 310830 );
+    REQUIRE( balancer::get_amount_out<80, 20>( amount_in, reserve_in, reserve_out ) == balancer::get_amount_out( amount_in, reserve_in, 80, reserve_out, 20 ) );
+    REQUIRE( balancer::get_amount_out<40, 60>( amount_in, reserve_in, reserve_out ) == balancer::get_amount_out( amount_in, reserve_in, 40, reserve_out, 60 ) );
+}
+
+TEST_CASE( "get_amount_in weighted inverse (pass)" ) {
+    // Inputs
+    const uint64_t amount_out = 310830;
+    const uint64_t reserve_in = 833515447;
+    const uint64_t reserve_out = 10395237882;
+    const uint64_t reserve_weight_in = 20;
+    const uint64_t reserve_weight_out = 80;
+
+    // Calculation
+    const uint64_t amount_in = balancer::get_amount_in( amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
+
+    REQUIRE( balancer::get_amount_out( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out ) >= amount_out );
+    REQUIRE( balancer::get_amount_out( amount_in - 1, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out ) < amount_out );
+    REQUIRE( balancer::get_amount_in( 39876, 100000000, 400000, 400000000, 600000 ) == balancer::pool( 100000000, 400000, 400000000, 600000 ).amount_in_exact( 39876 ) );
+
+    // extreme reserve / weight ratios, smallest covering input
+    std::mt19937_64 rng( 6 );
+    std::uniform_real_distribution<double> reserve_exp( 3, 18 );
+    std::uniform_real_distribution<double> share( 0, 0.99 );
+    for ( size_t i = 0; i < 20000; ++i ) {
+        const uint64_t reserve_a = pow( 10, reserve_exp( rng ) );
+        const uint64_t reserve_b = pow( 10, reserve_exp( rng ) );
+        const uint64_t weight_a = 1 + rng() % 99;
+        const uint64_t weight_b = 1 + rng() % 99;
+        const uint8_t fee = rng() % 100;
+        const uint64_t target = 1 + static_cast<uint64_t>( reserve_b * share( rng ) );
+        if ( target >= reserve_b ) continue;
+        const double precise = balancer::pool( reserve_a, weight_a, reserve_b, weight_b, fee ).amount_in_precise( target );
+        if ( precise > 1e19 ) continue;
+#if defined(BALANCER_FIXED_POINT)
+        if ( static_cast<balancer::uint128>( target ) * 3 > reserve_b || precise * 2 > reserve_a * 0.99 ) continue;     // MAX_OUT_RATIO / MAX_IN_RATIO
+#endif
+        const uint64_t required = balancer::get_amount_in( target, reserve_a, weight_a, reserve_b, weight_b, fee );
+        REQUIRE( balancer::get_amount_out( required, reserve_a, weight_a, reserve_b, weight_b, fee ) >= target );
+        if ( required > 1 ) REQUIRE( balancer::get_amount_out( required - 1, reserve_a, weight_a, reserve_b, weight_b, fee ) < target );
+    }
+}
+
+TEST_CASE( "get_amounts_out (pass)" ) {
+    // Inputs
+    const balancer::pool path[] = { balancer::pool( 100000000, 50, 400000000, 50 ), balancer::pool( 833515447, 20, 10395237882, 80 ) };
+
+    // Calculation
+    double amounts[3];
+    const uint64_t amount_out = balancer::get_amounts_out( path, 2, 10000, amounts );
+
+    REQUIRE( amounts[0] == 10000 );
+    REQUIRE( uint64_t(amounts[1]) == 39876 );
+    REQUIRE( amount_out == 123952 );
+}
+
+TEST_CASE( "get_amounts_in (pass)" ) {
+    // Inputs
+    const balancer::pool path[] = { balancer::pool( 100000000, 50, 400000000, 50 ), balancer::pool( 833515447, 20, 10395237882, 80 ) };
+
+    // Calculation
+    double amounts[3];
+    const uint64_t amount_in = balancer::get_amounts_in( path, 2, 123952, amounts );
+
+    REQUIRE( amount_in == 10000 );
+    REQUIRE( amounts[2] == 123952 );
+    REQUIRE( balancer::get_amounts_out( path, 2, amount_in, amounts ) >= 123952 );
+}
+
+TEST_CASE( "get_optimal_amount_in (pass)" ) {
+    // Inputs
+    const balancer::pool pool_a( 100000000, 50, 400000000, 50 );
+    const balancer::pool pool_b( 350000000, 50, 100000000, 50 );
+    const balancer::pool pool_c( 300000000, 80, 100000000, 20 );
+    const balancer::pool pool_d( 400000000, 50, 100000000, 50 );
+    const balancer::pool pool_e( 300000000, 40, 100000000, 60 );
+
+    // Calculation
+    const uint64_t closed_form = balancer::get_optimal_amount_in( pool_a, pool_b );
+    const uint64_t newton = balancer::get_optimal_amount_in( pool_a, pool_c );
+
+    REQUIRE( closed_form == 3086615 );
+    REQUIRE( newton == 25949358 );
+    REQUIRE( balancer::get_optimal_amount_in( pool_a, pool_d ) == 0 );
+    REQUIRE( balancer::get_optimal_amount_in( pool_e, pool_a ) == 0 );
+
+    // profit is maximal around the optimum
+    const int64_t profit = pool_c.amount_out( pool_a.amount_out( newton ) ) - newton;
+    REQUIRE( profit >= int64_t(pool_c.amount_out( pool_a.amount_out( newton - 10000 ) ) - (newton - 10000)) );
+    REQUIRE( profit >= int64_t(pool_c.amount_out( pool_a.amount_out( newton + 10000 ) ) - (newton + 10000)) );
+}
+
+TEST_CASE( "pool prices (pass)" ) {
+    // Inputs
+    const balancer::pool pool( 100000000, 500000, 400000000, 500000 );
+
+    // Calculation
+    const balancer::pool_prices prices = pool.prices( 10000 );
+
+    REQUIRE( prices.amount_out == pool.amount_out( 10000 ) );
+    REQUIRE( prices.quote == pool.quote( 10000 ) );
+    REQUIRE( prices.spot_price == 4 * balancer::BONE );
+    REQUIRE( prices.spot_price_with_fee == pool.spot_price_with_fee() );
+    REQUIRE( prices.spot_price_with_fee == 3988000000000000000ULL );
+    REQUIRE( prices.price_impact == pool.price_impact( 10000 ) );
+    REQUIRE( prices.price_impact / 1000000000 == 99690 ); // ~0.00997%
+}
+
+TEST_CASE( "pool spot_price low reserves (pass)" ) {
+    // Inputs
+    const balancer::pool pool( 3, 20, 7, 80 );
+
+    // (7 / 80) / (3 / 20) = 0.583333...
+    REQUIRE( pool.spot_price == 583333333333333333ULL );
+}
+
+TEST_CASE( "static_pool (pass)" ) {
+    typedef balancer::static_pool<20, 80> pool_20_80;
+    typedef balancer::static_pool<500000, 500000> pool_50_50;
+    typedef balancer::static_pool<40, 60, 25> pool_40_60;
+
+    // compile-time
+    constexpr uint64_t amount_out = pool_20_80::amount_out( 100000, 833515447, 10395237882 );
+    static_assert( amount_out == 310830, "compile-time quote" );
+    static_assert( pool_50_50::amount_out( 10000, 100000000, 400000000 ) == 39876, "compile-time quote" );
+    static_assert( pool_20_80::weight_ratio == balancer::BONE / 4, "weight ratio" );
+
+    // runtime, matches the fixed-point engine within BPOW_PRECISION
+    const uint64_t fixed = balancer::get_amount_out_fixed( 100000, 833515447, 40, 10395237882, 60, 25 );
+    const uint64_t table = pool_40_60::amount_out( 100000, 833515447, 10395237882 );
+    REQUIRE( (table > fixed ? table - fixed : fixed - table) <= 1 );
+}
+
+TEST_CASE( "check policies (pass)" ) {
+    // Inputs
+    const uint64_t amount_in = 100000;
+    const uint64_t reserve_in = 833515447;
+    const uint64_t reserve_out = 10395237882;
+    const uint64_t reserve_weight_in = 20;
+    const uint64_t reserve_weight_out = 80;
+    const balancer::pool pool( reserve_in, 40, reserve_out, 60 );
+
+    // Calculation
+    REQUIRE( balancer::get_amount_out<balancer::unchecked>( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out ) == 310830 );
+    REQUIRE( balancer::get_amount_out<balancer::debug_assert>( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out ) == 310830 );
+    REQUIRE( balancer::get_amount_out<20, 80, balancer::unchecked>( amount_in, reserve_in, reserve_out ) == 310830 );
+    REQUIRE( balancer::get_amount_in<balancer::unchecked>( 39876, 100000000, 500000, 400000000, 500000 ) == 10000 );
+    REQUIRE( balancer::quote<balancer::unchecked>( 10000, 100000000, 500000, 400000000, 500000 ) == 40000 );
+    REQUIRE( pool.amount_out<balancer::unchecked>( amount_in ) == pool.amount_out( amount_in ) );
+    REQUIRE( pool.amount_in<balancer::unchecked>( 100000 ) == pool.amount_in( 100000 ) );
+    REQUIRE( pool.quote<balancer::debug_assert>( amount_in ) == pool.quote( amount_in ) );
+    static_assert( balancer::static_pool<50, 50>::amount_out<balancer::unchecked>( 10000, 100000000, 400000000 ) == 39876, "unchecked compile-time quote" );
+}
+
+TEST_CASE( "large reserves (pass)" ) {
+    // Inputs (reserves above UINT64_MAX / 10000)
+    const uint64_t scale = 10000000000ULL;
+    const uint64_t amount_in = 10000 * scale;
+    const uint64_t reserve_in = 100000000 * scale;
+    const uint64_t reserve_out = 400000000 * scale;
+
+    // Calculation, scales like the small pool
+    REQUIRE( balancer::get_amount_out( amount_in, reserve_in, 500000, reserve_out, 500000 ) / scale == 39876 );
+    REQUIRE( balancer::get_amount_out( amount_in, reserve_in, 400000, reserve_out, 600000 ) / scale == balancer::get_amount_out( 10000, 100000000, 400000, 400000000, 600000 ) );
+    REQUIRE( balancer::get_amount_in( 39876 * scale, reserve_in, 500000, reserve_out, 500000 ) / scale == 9999 );
+    REQUIRE( balancer::quote( 10000 * scale, reserve_in, 500000, reserve_out, 500000 ) == 40000 * scale );
+    REQUIRE( balancer::pool( reserve_in, 500000, reserve_out, 500000 ).quote( 10000 * scale ) == 40000 * scale );
+    REQUIRE( balancer::quote( 1000, UINT64_MAX / 2, 1, UINT64_MAX, 1 ) == 2000 );
+}
+
+TEST_CASE( "multi_pool (pass)" ) {
+    // Inputs
+    const uint64_t balances[] = { 45851931234, 125682033533, 833515447, 10395237882 };
+    const uint64_t weights[] = { 30, 30, 10, 30 };
+    const balancer::multi_pool pool( balances, weights, 4 );
+
+    // Calculation, every pair matches the two-asset formulas
+    for ( size_t i = 0; i < 4; ++i ) {
+        for ( size_t j = 0; j < 4; ++j ) {
+            if ( i == j ) continue;
+            const balancer::pool pair = pool.pair( i, j );
+            REQUIRE( pool.amount_out( i, j, 100000 ) == host_amount_out( 100000, balances[i], weights[i], balances[j], weights[j] ) );
+            REQUIRE( pool.amount_out( i, j, 100000 ) == pair.amount_out( 100000 ) );
+            REQUIRE( pool.amount_in( i, j, 100000 ) == pair.amount_in( 100000 ) );
+            REQUIRE( pool.quote( i, j, 100000 ) == pair.quote( 100000 ) );
+            REQUIRE( pool.spot_price( i, j ) == pair.spot_price );
+            REQUIRE( pool.spot_price_with_fee( i, j ) == pair.spot_price_with_fee() );
+        }
+    }
+    REQUIRE( pool.amount_out( 0, 1, 10000 ) == 27328 );
+    REQUIRE( pool.weight_ratios[2][0] == 1.0 / 3 );
+    REQUIRE( pool.kinds[0][2] == balancer::get_curve_kind( 30, 10 ) );
+    REQUIRE( pool.kinds[0][1] == balancer::curve_kind::pow_1 );
+
+    // large balances, small trades match the exact curve (6646666.67 / 664666666.61)
+    const uint64_t large_balances[] = { 1000000000000000, 10000000000000000000ULL, 833515447 };
+    const uint64_t large_weights[] = { 40, 60, 20 };
+    const balancer::multi_pool large( large_balances, large_weights, 3 );
+    REQUIRE( large.amount_out( 0, 1, 1000 ) == 6646666 );
+    REQUIRE( large.amount_out( 0, 1, 100000 ) == 664666666 );
+    for ( uint64_t amount_in = 1000; amount_in < 1000000000000; amount_in = amount_in * 7 + 1 ) {
+        REQUIRE( large.amount_out( 0, 1, amount_in ) == host_amount_out( amount_in, large_balances[0], 40, large_balances[1], 60 ) );
+    }
+
+    // derived paths through `pool::amount_out`
+    const balancer::pool path[] = { large.pair( 0, 1 ), balancer::pool( 10000000000000000000ULL, 60, 1000000000000000, 40 ) };
+    double amounts[3];
+    uint64_t ladder_in[16];
+    uint64_t ladder_out[16];
+    REQUIRE( balancer::get_amounts_out( path, 2, 1000, amounts ) == host_amount_out( 6646666, 10000000000000000000ULL, 60, 1000000000000000, 40 ) );
+    balancer::sample_curve_geometric( path[0], 1000, 1000000000, ladder_in, ladder_out, 16 );
+    for ( size_t i = 0; i < 16; ++i ) REQUIRE( ladder_out[i] == host_amount_out( ladder_in[i], large_balances[0], 40, large_balances[1], 60 ) );
+}
+
+TEST_CASE( "multi_pool apply_swap (pass)" ) {
+    // Inputs
+    const uint64_t balances[] = { 100000000, 400000000, 833515447 };
+    const uint64_t weights[] = { 40, 40, 20 };
+    balancer::multi_pool pool( balances, weights, 3 );
+
+    // Calculation
+    const uint64_t amount_out = pool.amount_out( 0, 1, 10000 );
+    pool.apply_swap( 0, 1, 10000, amount_out );
+
+    // Result
+    REQUIRE( amount_out == 39876 );
+    REQUIRE( pool.balances[0] == 100010000 );
+    REQUIRE( pool.balances[1] == 400000000 - 39876 );
+    REQUIRE( pool.amount_out( 2, 0, 10000 ) == host_amount_out( 10000, 833515447, 20, 100010000, 40 ) );
+    REQUIRE( pool.amount_out( 1, 2, 10000 ) == host_amount_out( 10000, 400000000 - 39876, 40, 833515447, 20 ) );
+}
+
+TEST_CASE( "single-asset join / exit (pass)" ) {
+    // Inputs
+    const uint64_t balance = 100000000;
+    const uint64_t pool_supply = 1000000000;
+
+    // Calculation, 20/80 (closed form) and 30/80 (generic)
+    REQUIRE( balancer::pool_out_given_single_in( 10000000, balance, 20, pool_supply, 80 ) == 24061315 );
+    REQUIRE( balancer::single_in_given_pool_out( 24061315, balance, 20, pool_supply, 80 ) == 10000000 );
+    REQUIRE( balancer::single_out_given_pool_in( 10000000, balance, 20, pool_supply, 80 ) == 3931533 );
+    REQUIRE( balancer::pool_in_given_single_out( 3931533, balance, 20, pool_supply, 80 ) == 10000000 );
+    REQUIRE( balancer::pool_out_given_single_in( 10000000, balance, 30, pool_supply, 80 ) == 36321466 );
+    REQUIRE( balancer::single_out_given_pool_in( 10000000, balance, 30, pool_supply, 80 ) == 2639535 );
+
+    // inverse covers the requested amount
+    for ( uint64_t amount = 1000; amount < balance; amount *= 7 ) {
+        const uint64_t pool_out = balancer::single_in_given_pool_out( amount, balance, 30, pool_supply, 80 );
+        REQUIRE( balancer::pool_out_given_single_in( pool_out, balance, 30, pool_supply, 80 ) >= amount );
+        const uint64_t pool_in = balancer::pool_in_given_single_out( amount, balance, 30, pool_supply, 80 );
+        REQUIRE( balancer::single_out_given_pool_in( pool_in, balance, 30, pool_supply, 80 ) >= amount );
+    }
+
+    // multi_pool shares balances, weights and fee
+    const uint64_t balances[] = { 45851931234, balance, 833515447 };
+    const uint64_t weights[] = { 40, 20, 20 };
+    const balancer::multi_pool pool( balances, weights, 3 );
+    REQUIRE( pool.total_weight == 80 );
+    REQUIRE( pool.pool_out_given_single_in( 1, 10000000, pool_supply ) == 24061315 );
+    REQUIRE( pool.single_in_given_pool_out( 1, 24061315, pool_supply ) == 10000000 );
+    REQUIRE( pool.single_out_given_pool_in( 1, 10000000, pool_supply ) == 3931533 );
+    REQUIRE( pool.pool_in_given_single_out( 1, 3931533, pool_supply ) == 10000000 );
+}
+
+TEST_CASE( "get_amount_out_approx (pass)" ) {
+    // Inputs
+    const uint64_t reserve_in = 833515447;
+    const uint64_t reserve_out = 10395237882;
+    const balancer::pool pool( reserve_in, 40, reserve_out, 60 );
+
+    // Calculation, within `APPROX_MAX_ERROR` of the exact curve from dust to 10x the reserve
+    for ( double amount_in = 1; amount_in < 1e10; amount_in *= 3 ) {
+        const double exact = pool.amount_out_precise( amount_in );
+        REQUIRE( fabs(balancer::get_amount_out_approx( amount_in, reserve_in, 40, reserve_out, 60 ) / exact - 1) < balancer::APPROX_MAX_ERROR );
+        REQUIRE( fabs(pool.amount_out_approx( amount_in ) / exact - 1) < balancer::APPROX_MAX_ERROR );
+    }
+
+    // closed-form weight ratios are exact
+    REQUIRE( balancer::get_amount_out_approx( 10000, 100000000, 50, 400000000, 50 ) == balancer::pool( 100000000, 50, 400000000, 50 ).amount_out_precise( 10000 ) );
+    REQUIRE( static_cast<uint64_t>(balancer::get_amount_out_approx( 100000, reserve_in, 40, reserve_out, 60 )) == 828860 );
+}
+
+TEST_CASE( "curve_table (pass)" ) {
+    // Inputs
+    const uint64_t reserve_in = 833515447;
+    const uint64_t reserve_out = 10395237882;
+    const balancer::curve_table table( 40, 60 );
+    const balancer::curve_table whole( 7, 3 );
+    const balancer::curve_table closed( 20, 80 );
+
+    // Calculation, `x ^ ratio` across every exponent and segment
+    for ( double x = 1; x > 1e-20; x *= 0.937 ) {
+        REQUIRE( fabs(table.pow( x ) / pow( x, 40.0 / 60 ) - 1) < 1e-14 );
+        REQUIRE( fabs(whole.pow( x ) / pow( x, 7.0 / 3 ) - 1) < 1e-14 );
+    }
+    REQUIRE( table.pow( 1 ) == 1 );
+
+    // `log1p` / `1 - exp(-L)` kernels within a few ULPs across the series, segment and exponent ranges
+    for ( double x = 1e-20; x < 1e20; x *= 1.173 ) {
+        REQUIRE( fabs(table.log1p( x ) / log1p( x ) - 1) < 1e-15 );
+        REQUIRE( fabs(table.decay( x ) / -expm1( -x ) - 1) < 1e-15 );
+    }
+
+    // matches `get_amount_out` within one unit, closed forms exactly
+    for ( uint64_t amount_in = 1; amount_in < 10 * reserve_in; amount_in = amount_in * 3 + 1 ) {
+        const uint64_t expected = host_amount_out( amount_in, reserve_in, 40, reserve_out, 60 );
+        const uint64_t amount_out = table.amount_out( amount_in, reserve_in, reserve_out );
+        REQUIRE( (amount_out > expected ? amount_out - expected : expected - amount_out) <= 1 );
+        REQUIRE( closed.amount_out( amount_in, reserve_in, reserve_out ) == host_amount_out( amount_in, reserve_in, 20, reserve_out, 80 ) );
+    }
+    REQUIRE( table.amount_out( 100000, reserve_in, reserve_out ) == 828860 );
+
+    // dust and small trades against deep reserves (exact curve 6646666.67)
+    REQUIRE( balancer::curve_table( 26, 22 ).amount_out( 1, 7511116341888100352, 4996574405889956, 42 ) == 0 );
+    REQUIRE( table.amount_out( 1000, 1000000000000000, 10000000000000000000ULL ) == host_amount_out( 1000, 1000000000000000, 40, 10000000000000000000ULL, 60 ) );
+
+    // random reserves, within one unit plus `amount_out * MAX_ERROR`
+    std::mt19937_64 rng( 17 );
+    std::uniform_real_distribution<double> reserve_exp( 3, 18.9 );
+    std::uniform_real_distribution<double> trade_exp( -7, 1 );
+    for ( size_t i = 0; i < 50000; ++i ) {
+        const uint64_t reserve_a = pow( 10, reserve_exp( rng ) );
+        const uint64_t reserve_b = pow( 10, reserve_exp( rng ) );
+        const uint64_t weight_a = 1 + rng() % 99;
+        const uint64_t weight_b = 1 + rng() % 99;
+        const uint8_t fee = rng() % 100;
+        const uint64_t amount_in = 1 + static_cast<uint64_t>( reserve_a * pow( 10, trade_exp( rng ) ) );
+        const balancer::curve_table random( weight_a, weight_b );
+        const uint64_t expected = host_amount_out( amount_in, reserve_a, weight_a, reserve_b, weight_b, fee );
+        const uint64_t amount_out = random.amount_out( amount_in, reserve_a, reserve_b, fee );
+        const double bound = 1 + expected * balancer::curve_table::MAX_ERROR;
+        REQUIRE( (amount_out > expected ? amount_out - expected : expected - amount_out) <= bound );
+    }
+}
+
+TEST_CASE( "quote_engine (pass)" ) {
+    // Inputs
+    const size_t size = 1000;
+    const size_t count = 8;
+    std::vector<uint64_t> reserves_in, weights_in, reserves_out, weights_out;
+    std::vector<uint8_t> fees;
+    for ( size_t i = 0; i < size; ++i ) {
+        reserves_in.push_back(1000000 + i * 7919);
+        reserves_out.push_back(5000000 + i * 104729);
+        weights_in.push_back(10 + i % 81);
+        weights_out.push_back(90 - i % 71);
+        fees.push_back(i % 100);
+    }
+    const balancer::snapshot pools = { size, reserves_in.data(), weights_in.data(), reserves_out.data(), weights_out.data(), fees.data() };
+    const uint64_t amounts_in[count] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+
+    // Calculation
+    balancer::quote_engine engine( 4 );
+    balancer::quote_engine serial( 1 );
+    std::vector<uint64_t> results(size * count), again(size * count, 0), single(size * count, 0);
+    engine.get_amounts_out( pools, amounts_in, count, results.data() );
+    engine.get_amounts_out( pools, amounts_in, count, again.data() );
+    serial.get_amounts_out( pools, amounts_in, count, single.data() );
+
+    // Result, deterministic row-major matrix
+    REQUIRE( engine.threads() == 4 );
+    REQUIRE( results == again );
+    REQUIRE( results == single );
+    for ( size_t i = 0; i < size; i += 37 ) {
+        for ( size_t j = 0; j < count; ++j ) {
+            REQUIRE( results[i * count + j] == host_amount_out( amounts_in[j], reserves_in[i], weights_in[i], reserves_out[i], weights_out[i], fees[i] ) );
+        }
+    }
+}
+
+TEST_CASE( "pool apply_join / apply_exit (pass)" ) {
+    // Inputs
+    balancer::pool pool( 833515447, 40, 10395237882, 60 );
+    uint64_t multi_balances[] = { 833515447, 10395237882, 45851931234 };
+    const uint64_t multi_weights[] = { 40, 60, 100 };
+    balancer::multi_pool multi( multi_balances, multi_weights, 3 );
+
+    // Calculation, replayed events
+    pool.apply_join( 1000000, 0 );
+    pool.apply_swap( 100000, pool.amount_out( 100000 ) );
+    pool.apply_join( 0, 5000000 );
+    pool.apply_exit( 2000000, 3000000 );
+    pool.apply_exit( 0, 1000 );
+    multi.apply_join( 2, 1000000 );
+    multi.apply_exit( 0, 5000 );
+
+    // Result, every cached term matches a rebuilt pool
+    const balancer::pool rebuilt( pool.reserve_in, 40, pool.reserve_out, 60 );
+    REQUIRE( pool.reserve_in == 833515447 + 1000000 + 100000 - 2000000 );
+    REQUIRE( pool.reserve_in_scaled == rebuilt.reserve_in_scaled );
+    REQUIRE( pool.weighted_reserve_in == rebuilt.weighted_reserve_in );
+    REQUIRE( pool.weighted_reserve_out == rebuilt.weighted_reserve_out );
+    REQUIRE( pool.spot_price == rebuilt.spot_price );
+    REQUIRE( pool.amount_out( 100000 ) == rebuilt.amount_out( 100000 ) );
+
+    multi_balances[2] += 1000000;
+    multi_balances[0] -= 5000;
+    const balancer::multi_pool multi_rebuilt( multi_balances, multi_weights, 3 );
+    for ( size_t i = 0; i < 3; ++i ) {
+        REQUIRE( multi.balances[i] == multi_rebuilt.balances[i] );
+        REQUIRE( multi.weighted_balances[i] == multi_rebuilt.weighted_balances[i] );
+    }
+}
+
+TEST_CASE( "sample_curve (pass)" ) {
+    // Inputs
+    const balancer::pool pool( 833515447, 40, 10395237882, 60 );
+    const size_t count = 200;
+
+    // Calculation
+    uint64_t amounts_in[count];
+    uint64_t amounts_out[count];
+    uint64_t ladder_out[count];
+    balancer::sample_curve_geometric( pool, 1000, 1000000000, amounts_in, amounts_out, count );
+    balancer::sample_curve( pool, amounts_in, ladder_out, count );
+
+    // Result, geometric rungs and outputs identical to `pool.amount_out`
+    REQUIRE( amounts_in[0] == 1000 );
+    REQUIRE( amounts_in[count - 1] == 1000000000 );
+    for ( size_t i = 0; i < count; ++i ) {
+        REQUIRE( amounts_out[i] == pool.amount_out( amounts_in[i] ) );
+        REQUIRE( ladder_out[i] == amounts_out[i] );
+        if ( i > 0 ) REQUIRE( fabs(static_cast<double>(amounts_in[i]) / amounts_in[i - 1] - pow(1e6, 1.0 / (count - 1))) < 1e-3 );
+    }
+}
+
+#if defined(BALANCER_INSTRUMENTATION)
+static uint64_t hook_calls = 0;
+static void count_hook( const balancer::instrumentation::counter, const uint64_t ) { ++hook_calls; }
+
+TEST_CASE( "instrumentation (pass)" ) {
+    using balancer::instrumentation::counter;
+    using balancer::instrumentation::get;
+
+    // Calculation
+    balancer::instrumentation::reset();
+    balancer::instrumentation::set_hook( count_hook, 2 );
+    balancer::get_amount_out( 10000, 45851931234, 50000, 125682033533, 50000 );
+    balancer::get_amount_out( 100000, 833515447, 40, 10395237882, 60 );
+    balancer::get_amount_in( 39876, 100000000, 500000, 400000000, 500000 );
+    balancer::quote( 10000, 100000000, 500000, 400000000, 500000 );
+    balancer::quote( 1000, UINT64_MAX / 2, 1, UINT64_MAX, 1 );
+    balancer::get_amount_out_with_fees( 100000, 100000000, 50, 400000000, 50, 25, 5 );
+    balancer::instrumentation::set_hook( nullptr );
+
+    // Result
+    REQUIRE( get( counter::get_amount_out ) == 2 );
+    REQUIRE( get( counter::get_amount_in ) == 1 );
+    REQUIRE( get( counter::quote ) == 2 );
+    REQUIRE( get( counter::get_amount_out_with_fees ) == 1 );
+    REQUIRE( get( counter::closed_form ) == 3 );
+    REQUIRE( get( counter::generic ) == 1 );
+    REQUIRE( get( counter::wide_math ) == 1 );
+    REQUIRE( get( counter::check_failure ) == 0 );
+    REQUIRE( hook_calls == 3 );     // every 2nd event: get_amount_out, quote, closed_form
+}
+#endif
+
+TEST_CASE( "get_amounts_in_exact (pass)" ) {
+    // Inputs
+    const balancer::pool path[] = { balancer::pool( 100000000, 50, 400000000, 50 ), balancer::pool( 833515447, 20, 10395237882, 80 ) };
+    const balancer::pool large( 728851322037814, 32, 298658653124078, 42 );
+
+    // Calculation
+    uint64_t amounts[3];
+    const uint64_t amount_in = balancer::get_amounts_in_exact( path, 2, 123952, amounts );
+
+    // Result, forward through `get_amount_out` covers the requested output
+    REQUIRE( amount_in == 10000 );
+    REQUIRE( amounts[1] == 39876 );
+    REQUIRE( balancer::get_amount_out( amounts[0], 100000000, 50, 400000000, 50 ) >= amounts[1] );
+    REQUIRE( balancer::get_amount_out( amounts[1], 833515447, 20, 10395237882, 80 ) >= 123952 );
+
+    // large trade, the smallest covering input
+    const uint64_t amount_out = 71551881517921;
+    const uint64_t exact = large.amount_in_exact( amount_out );
+    REQUIRE( balancer::get_amount_out( exact, large.reserve_in, 32, large.reserve_out, 42 ) >= amount_out );
+    REQUIRE( balancer::get_amount_out( exact - 1, large.reserve_in, 32, large.reserve_out, 42 ) < amount_out );
+#if !defined(BALANCER_FIXED_POINT)
+    REQUIRE( exact == 316226657214299 );
+#endif
+
+    // every route amount covers the next hop
+    for ( uint64_t target = 1000; target < 1000000000; target = target * 5 + 3 ) {
+        balancer::get_amounts_in_exact( path, 2, target, amounts );
+        uint64_t forward = amounts[0];
+        forward = balancer::get_amount_out( forward, 100000000, 50, 400000000, 50 );
+        forward = balancer::get_amount_out( forward, 833515447, 20, 10395237882, 80 );
+        REQUIRE( forward >= target );
+    }
+
+    // random deep pools, identical to `get_amount_in` and the smallest covering input per hop
+    std::mt19937_64 rng( 22 );
+    std::uniform_real_distribution<double> reserve_exp( 3, 19 );
+    std::uniform_real_distribution<double> share_exp( -12, -0.5 );
+    for ( size_t i = 0; i < 20000; ++i ) {
+        const uint64_t reserve_a = std::min( 1e19, pow( 10, reserve_exp( rng ) ) );
+        const uint64_t reserve_b = std::min( 1e19, pow( 10, reserve_exp( rng ) ) );
+        const uint64_t weight_a = i % 3 == 0 ? 50 : 1 + rng() % 99;
+        const uint64_t weight_b = i % 3 == 0 ? 50 : 1 + rng() % 99;
+        const uint8_t fee = rng() % 100;
+        const uint64_t target = 1 + static_cast<uint64_t>( reserve_b * pow( 10, share_exp( rng ) ) );
+        const balancer::pool hop( reserve_a, weight_a, reserve_b, weight_b, fee );
+        if ( target >= reserve_b || hop.amount_in_precise( target ) > 1e19 ) continue;
+#if defined(BALANCER_FIXED_POINT)
+        if ( static_cast<balancer::uint128>( target ) * 3 > reserve_b || hop.amount_in_precise( target ) * 2 > reserve_a * 0.99 ) continue;     // MAX_OUT_RATIO / MAX_IN_RATIO
+#endif
+        balancer::get_amounts_in_exact( &hop, 1, target, amounts );
+        REQUIRE( amounts[0] == balancer::get_amount_in( target, reserve_a, weight_a, reserve_b, weight_b, fee ) );
+        REQUIRE( balancer::get_amount_out( amounts[0], reserve_a, weight_a, reserve_b, weight_b, fee ) >= target );
+        if ( amounts[0] > 1 ) REQUIRE( balancer::get_amount_out( amounts[0] - 1, reserve_a, weight_a, reserve_b, weight_b, fee ) < target );
+    }
+}
+
+TEST_CASE( "quote_price / quote_batch (pass)" ) {
+    // Inputs
+    const uint64_t amounts_a[] = { 10000, 20000, 30000 };
+    const balancer::quote_price price( 45851931234, 50000, 125682033533, 50000 );
+
+    // Calculation
+    uint64_t amounts_b[3];
+    balancer::quote_batch( amounts_a, amounts_b, 3, 45851931234, 50000, 125682033533, 50000 );
+
+    // Result
+    REQUIRE( price.exact );
+    REQUIRE( price.quote( 10000 ) == 27410 );
+    REQUIRE( amounts_b[0] == 27410 );
+    REQUIRE( amounts_b[1] == 54820 );
+    REQUIRE( amounts_b[2] == 82231 );
+
+    // weighted reserves above 64 bits, division fallback
+    const balancer::quote_price wide( 18446744073709551615ULL, 1, 18446744073709551615ULL, 2 );
+    REQUIRE( !wide.exact );
+    REQUIRE( wide.quote( 1000000 ) == balancer::quote( 1000000, 18446744073709551615ULL, 1, 18446744073709551615ULL, 2 ) );
+
+    // identical to `quote`, including products above 64 bits
+    std::mt19937_64 rng( 23 );
+    for ( size_t i = 0; i < 2000; ++i ) {
+        const uint64_t reserve_a = ( rng() >> ( rng() % 40 ) ) | 1;
+        const uint64_t reserve_b = ( rng() >> ( rng() % 40 ) ) | 1;
+        const uint64_t weight_a = 1 + rng() % 10000;
+        const uint64_t weight_b = 1 + rng() % 10000;
+        const uint64_t amount_a = 1 + ( rng() >> ( 20 + rng() % 44 ) );
+        if ( static_cast<balancer::uint128>( reserve_a ) * 10000 / weight_a == 0 ) continue;
+
+        const balancer::quote_price pair( reserve_a, weight_a, reserve_b, weight_b );
+        const balancer::uint128 expected = static_cast<balancer::uint128>( static_cast<balancer::uint128>( reserve_b ) * 10000 / weight_b ) * amount_a / pair.weighted_reserve_a;
+        if ( expected >> 64 ) continue;
+        REQUIRE( pair.quote( amount_a ) == balancer::quote( amount_a, reserve_a, weight_a, reserve_b, weight_b ) );
+    }
+}
+
+TEST_CASE( "write_snapshot / mapped_snapshot (pass)" ) {
+    // Inputs
+    const uint64_t reserves_in[] = { 45851931234, 833515447, 100000000 };
+    const uint64_t weights_in[] = { 50000, 20, 30 };
+    const uint64_t reserves_out[] = { 125682033533, 10395237882, 400000000 };
+    const uint64_t weights_out[] = { 50000, 80, 70 };
+    const uint8_t fees[] = { 30, 30, 0 };
+    const balancer::snapshot pools = { 3, reserves_in, weights_in, reserves_out, weights_out, fees };
+    const uint64_t amounts_in[] = { 10000, 100000 };
+
+    // Calculation
+    balancer::write_snapshot( "balancer.snapshot.tmp.out", pools );
+    {
+        const balancer::mapped_snapshot file( "balancer.snapshot.tmp.out" );
+        balancer::quote_engine engine( 2 );
+        uint64_t results[6];
+        engine.get_amounts_out( file.pools(), amounts_in, 2, results );
+
+        // Result, raw columns feed the batch APIs directly
+        REQUIRE( file.size() == 3 );
+        REQUIRE( results[0] == 27328 );
+        REQUIRE( results[1] == 273281 );
+        REQUIRE( results[2] == 31085 );
+        REQUIRE( results[3] == 310830 );
+        for ( size_t i = 0; i < 3; ++i ) {
+            REQUIRE( file.pools().reserves_in[i] == reserves_in[i] );
+            REQUIRE( file.pools().weights_in[i] == weights_in[i] );
+            REQUIRE( file.pools().reserves_out[i] == reserves_out[i] );
+            REQUIRE( file.pools().weights_out[i] == weights_out[i] );
+            REQUIRE( file.pools().fees[i] == fees[i] );
+            REQUIRE( results[i * 2 + 1] == host_amount_out( 100000, reserves_in[i], weights_in[i], reserves_out[i], weights_out[i], fees[i] ) );
+
+            // pools built from the cached weight terms
+            const balancer::pool cached = file.pool( i );
+            const balancer::pool parsed( reserves_in[i], weights_in[i], reserves_out[i], weights_out[i], fees[i] );
+            REQUIRE( cached.kind == parsed.kind );
+            REQUIRE( cached.inverse_kind == parsed.inverse_kind );
+            REQUIRE( cached.weight_ratio == parsed.weight_ratio );
+            REQUIRE( cached.inverse_ratio == parsed.inverse_ratio );
+            REQUIRE( cached.spot_price == parsed.spot_price );
+            REQUIRE( cached.amount_out( 100000 ) == parsed.amount_out( 100000 ) );
+            REQUIRE( cached.amount_in_exact( 100000 ) == parsed.amount_in_exact( 100000 ) );
+        }
+    }
+    std::remove( "balancer.snapshot.tmp.out" );
+}
+
+TEST_CASE( "get_amount_out_with_derivative (pass)" ) {
+    // Calculation
+    const balancer::curve_point point = balancer::get_amount_out_with_derivative( 100000, 833515447, 20, 10395237882, 80 );
+    const balancer::curve_point spot = balancer::get_amount_out_with_derivative( 0, 833515447, 20, 10395237882, 80 );
+
+    // Result, same curve as `get_amount_out` and `pool::curve_at`
+    REQUIRE( static_cast<uint64_t>( point.amount_out ) == host_amount_out( 100000, 833515447, 20, 10395237882, 80 ) );
+    REQUIRE( point.derivative == Approx( 3.108071605 ) );
+    REQUIRE( point.second_derivative == Approx( -4.646549731e-09 ) );
+    REQUIRE( point.derivative == balancer::pool( 833515447, 20, 10395237882, 80 ).curve_at( 100000 ).derivative );
+    REQUIRE( spot.amount_out == 0 );
+    REQUIRE( spot.derivative == Approx( 10395237882.0 / 80 / ( 833515447.0 / 20 ) * 0.997 ) );
+
+    // central differences, closed-form and generic weight ratios
+    const uint64_t weights[][2] = { { 50, 50 }, { 20, 80 }, { 80, 20 }, { 37, 61 }, { 1, 99 } };
+    for ( size_t i = 0; i < 5; ++i ) {
+        for ( double amount_in = 1000; amount_in < 1e10; amount_in *= 7 ) {
+            const double h = amount_in * 1e-4;
+            const balancer::curve_point p = balancer::get_amount_out_with_derivative( amount_in, 833515447, weights[i][0], 10395237882, weights[i][1] );
+            const balancer::curve_point a = balancer::get_amount_out_with_derivative( amount_in + h, 833515447, weights[i][0], 10395237882, weights[i][1] );
+            const balancer::curve_point b = balancer::get_amount_out_with_derivative( amount_in - h, 833515447, weights[i][0], 10395237882, weights[i][1] );
+            REQUIRE( p.derivative == Approx( ( a.amount_out - b.amount_out ) / ( 2 * h ) ).epsilon( 1e-5 ) );
+            REQUIRE( p.second_derivative == Approx( ( a.derivative - b.derivative ) / ( 2 * h ) ).epsilon( 1e-5 ) );
+        }
+    }
+}
+
+// `get_amount_out` of directed edge `e` (unchecked as `route_graph`, trades past the fixed-point ratio limit are quoted)
+static uint64_t edge_amount_out( const balancer::route_graph& graph, const size_t e, const uint64_t amount )
+{
+    const balancer::snapshot edges = graph.view();
+    return balancer::get_amount_out<balancer::unchecked>( amount, edges.reserves_in[e], edges.weights_in[e], edges.reserves_out[e], edges.weights_out[e], edges.fees[e] );
+}
+
+// best output over every walk of at most `hops` hops, one `get_amount_out` per edge
+static uint64_t brute_force_route( const balancer::route_graph& graph, const uint32_t token, const uint32_t to, const uint64_t amount, const size_t hops )
+{
+    uint64_t best = 0;
+    if ( hops == 0 ) return best;
+    for ( size_t e = graph.edges_begin( token ); e < graph.edges_end( token ); ++e ) {
+        const uint64_t amount_out = edge_amount_out( graph, e, amount );
+        if ( graph.target( e ) == to ) best = std::max( best, amount_out );
+        if ( amount_out > 0 ) best = std::max( best, brute_force_route( graph, graph.target( e ), to, amount_out, hops - 1 ) );
+    }
+    return best;
+}
+
+TEST_CASE( "route_graph (pass)" ) {
+    // Inputs
+    const balancer::route_pair pairs[] = {
+        { 0, 1, 100000000, 50, 400000000, 50, 30 },
+        { 1, 2, 833515447, 20, 10395237882, 80, 30 },
+        { 0, 2, 1000000, 50, 10000000, 50, 30 },
+    };
+    balancer::route_graph graph( 3, pairs, 3 );
+
+    // Calculation
+    const balancer::route route = graph.best_route( 0, 2, 10000 );
+
+    // Result
+    REQUIRE( graph.edge_count() == 6 );
+    REQUIRE( route.hops == 2 );
+    REQUIRE( route.amount_out == 123952 );
+    REQUIRE( route.tokens[0] == 0 );
+    REQUIRE( route.tokens[1] == 1 );
+    REQUIRE( route.tokens[2] == 2 );
+    REQUIRE( graph.source( route.edges[0] ) == 0 );
+    REQUIRE( graph.target( route.edges[1] ) == 2 );
+    REQUIRE( graph.edge( route.edges[1] ).reserve_in == 833515447 );
+
+    // direct pair after it deepens
+    graph.update_pair( 2, 100000000, 2000000000 );
+    const balancer::route direct = graph.best_route( 0, 2, 10000, 2 );
+    REQUIRE( direct.hops == 1 );
+    REQUIRE( direct.amount_out == balancer::get_amount_out( 10000, 100000000, 50, 2000000000, 50 ) );
+
+    // random universe against every walk
+    std::mt19937_64 rng( 27 );
+    std::vector<balancer::route_pair> universe;
+    for ( size_t p = 0; p < 14; ++p ) {
+        const uint32_t a = rng() % 7;
+        const uint32_t b = ( a + 1 + rng() % 6 ) % 7;
+        universe.push_back( { a, b, 1000000 + rng() % 1000000000, 10 + rng() % 80, 1000000 + rng() % 1000000000, 10 + rng() % 80, static_cast<uint8_t>( rng() % 50 ) } );
+    }
+    balancer::route_graph random( 7, universe.data(), universe.size() );
+    for ( uint32_t from = 0; from < 7; ++from ) {
+        for ( uint32_t to = 0; to < 7; ++to ) {
+            const balancer::route best = random.best_route( from, to, 1000000, 3 );
+            REQUIRE( best.amount_out == brute_force_route( random, from, to, 1000000, 3 ) );
+            if ( best.hops == 0 ) continue;
+
+            // replaying the hops with `get_amount_out` reproduces the amount
+            uint64_t amount = 1000000;
+            for ( size_t k = 0; k < best.hops; ++k ) {
+                REQUIRE( random.source( best.edges[k] ) == best.tokens[k] );
+                REQUIRE( random.target( best.edges[k] ) == best.tokens[k + 1] );
+                amount = edge_amount_out( random, best.edges[k], amount );
+            }
+            REQUIRE( amount == best.amount_out );
+            REQUIRE( random.amount_out( best, 1000000 ) == best.amount_out );
+        }
+    }
+
+    // deep reserves (outputs above 2^53), every hop still equals `get_amount_out`
+    std::vector<balancer::route_pair> deep;
+    for ( size_t p = 0; p < 10; ++p ) {
+        const uint32_t a = rng() % 5;
+        const uint32_t b = ( a + 1 + rng() % 4 ) % 5;
+        const uint64_t weight = p % 2 ? 50 : 10 + rng() % 80;
+        deep.push_back( { a, b, 1000000000000000 + rng() % 9000000000000000000, weight, 1000000000000000 + rng() % 9000000000000000000, 100 - weight, static_cast<uint8_t>( rng() % 50 ) } );
+    }
+    balancer::route_graph deep_graph( 5, deep.data(), deep.size() );
+    uint64_t deepest = 0;
+    for ( uint32_t from = 0; from < 5; ++from ) {
+        for ( uint32_t to = 0; to < 5; ++to ) {
+            const uint64_t amount_in = 100000000000000;
+            const balancer::route best = deep_graph.best_route( from, to, amount_in, 3 );
+            REQUIRE( best.amount_out == brute_force_route( deep_graph, from, to, amount_in, 3 ) );
+            uint64_t amount = amount_in;
+            for ( size_t k = 0; k < best.hops; ++k ) amount = edge_amount_out( deep_graph, best.edges[k], amount );
+            REQUIRE( amount == best.amount_out );
+            deepest = std::max( deepest, best.amount_out );
+        }
+    }
+    REQUIRE( deepest > ( uint64_t( 1 ) << 53 ) );
+}
+
+TEST_CASE( "quote_stream (pass)" ) {
+    // Inputs
+    const balancer::route_pair pairs[] = {
+        { 0, 1, 100000000, 50, 400000000, 50, 30 },
+        { 1, 2, 833515447, 20, 10395237882, 80, 30 },
+        { 0, 2, 1000000, 50, 10000000, 50, 30 },
+        { 2, 3, 500000000, 50, 500000000, 50, 30 },
+    };
+    balancer::route_graph graph( 4, pairs, 4 );
+    balancer::quote_stream stream( graph );
+    const balancer::route route = graph.best_route( 0, 2, 10000 );
+
+    // single hops over pair `pair` leaving `token`
+    const auto hop = [&]( const uint32_t token, const size_t pair ) {
+        balancer::route single = {};
+        single.hops = 1;
+        for ( size_t e = graph.edges_begin( token ); e < graph.edges_end( token ); ++e ) if ( graph.pair_of( e ) == pair ) single.edges[0] = e;
+        return single;
+    };
+    const balancer::route other = hop( 2, 3 );
+
+    // Calculation
+    const size_t id = stream.subscribe( route, 10000 );
+    const size_t other_id = stream.subscribe( other, 10000 );
+
+    // Result
+    REQUIRE( stream.size() == 2 );
+    REQUIRE( stream.quote( id ) == 123952 );
+    REQUIRE( stream.quote( other_id ) == balancer::get_amount_out( 10000, 500000000, 50, 500000000, 50 ) );
+    REQUIRE( stream.evaluations() == 2 );
+
+    // cached until a dependency changes
+    REQUIRE( stream.quote( id ) == 123952 );
+    REQUIRE( stream.evaluations() == 2 );
+
+    // a trade on the first hop, only `id` is recomputed
+    stream.apply_swap( route.edges[0], 500000, 1984109 );
+    REQUIRE( stream.is_stale( id ) );
+    REQUIRE( !stream.is_stale( other_id ) );
+    REQUIRE( graph.edge( route.edges[0] ).reserve_in == 100500000 );
+    REQUIRE( graph.edge( route.edges[0] ).reserve_out == 400000000 - 1984109 );
+    REQUIRE( stream.quote( id ) == 122721 );
+    REQUIRE( stream.quote( id ) == graph.amount_out( route, 10000 ) );
+    REQUIRE( stream.quote( other_id ) == balancer::get_amount_out( 10000, 500000000, 50, 500000000, 50 ) );
+    REQUIRE( stream.evaluations() == 3 );
+
+    // mirrored direction of the traded pair
+    const balancer::route back = hop( 1, 0 );
+    REQUIRE( graph.edge( back.edges[0] ).reserve_in == 400000000 - 1984109 );
+    REQUIRE( graph.edge( back.edges[0] ).reserve_out == 100500000 );
+
+    // untouched pair update leaves `id` cached
+    stream.update_pair( 3, 600000000, 400000000 );
+    REQUIRE( !stream.is_stale( id ) );
+    REQUIRE( stream.quote( other_id ) == balancer::get_amount_out( 10000, 600000000, 50, 400000000, 50 ) );
+    REQUIRE( stream.evaluations() == 4 );
+
+    // deep reserves (outputs above 2^53), requotes equal `get_amount_out` hop by hop
+    const balancer::route_pair deep_pairs[] = {
+        { 0, 1, 4000000000000000000, 50, 9000000000000000000, 50, 30 },
+        { 1, 2, 7000000000000000000, 20, 2000000000000000, 80, 30 },
+        { 0, 2, 1000000000000000, 50, 3000000000000000000, 50, 30 },
+    };
+    balancer::route_graph deep_graph( 3, deep_pairs, 3 );
+    balancer::quote_stream deep_stream( deep_graph );
+    const uint64_t amount_in = 100000000000000000;
+    const balancer::route deep_route = deep_graph.best_route( 0, 1, amount_in );
+    const size_t deep_id = deep_stream.subscribe( deep_route, amount_in );
+    const auto replay = [&]() {
+        uint64_t amount = amount_in;
+        for ( size_t k = 0; k < deep_route.hops; ++k ) amount = edge_amount_out( deep_graph, deep_route.edges[k], amount );
+        return amount;
+    };
+    REQUIRE( deep_stream.quote( deep_id ) > ( uint64_t( 1 ) << 53 ) );
+    REQUIRE( deep_stream.quote( deep_id ) == replay() );
+    deep_stream.apply_swap( deep_route.edges[0], amount_in, edge_amount_out( deep_graph, deep_route.edges[0], amount_in ) );
+    REQUIRE( deep_stream.is_stale( deep_id ) );
+    REQUIRE( deep_stream.quote( deep_id ) == replay() );
+    deep_stream.update_pair( 0, 5000000000000000000, 8000000000000000000 );
+    REQUIRE( deep_stream.quote( deep_id ) == replay() );
+}
+
+// check policy keeping the first failed message instead of aborting
+struct recorded_check {
+    static const char* message;
+    static void check( const bool pred, const char* msg ) { if ( !pred && !message ) message = msg; }
+};
+const char* recorded_check::message = nullptr;
+
+TEST_CASE( "get_amount_in_fixed (pass)" ) {
+    // Inputs
+    const uint64_t amount_out = 310830;
+    const uint64_t reserve_in = 833515447;
+    const uint64_t reserve_weight_in = 20;
+    const uint64_t reserve_out = 10395237882;
+    const uint64_t reserve_weight_out = 80;
+
+    // Calculation
+    const uint64_t amount_in = balancer::get_amount_in_fixed( amount_out, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
+
+    // Result, smallest input the fixed-point forward curve covers
+    REQUIRE( amount_in == 100000 );
+    REQUIRE( balancer::get_amount_out_fixed( amount_in, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out ) >= amount_out );
+    REQUIRE( balancer::get_amount_out_fixed( amount_in - 1, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out ) < amount_out );
+
+    // every input within MAX_IN_RATIO covers its output, within `2^-23` of the smallest covering input and the double path
+    std::mt19937_64 rng( 29 );
+    size_t covered = 0;
+    for ( size_t i = 0; i < 4000; ++i ) {
+        const uint64_t reserve_a = 1000 + rng() % 1000000000000;
+        const uint64_t reserve_b = 1000 + rng() % 1000000000000;
+        const uint64_t weight_a = 1 + rng() % 99;
+        const uint64_t weight_b = 1 + rng() % 99;
+        const uint64_t target = 1 + rng() % ( reserve_b / 3 );
+        const double expected = balancer::pool( reserve_a, weight_a, reserve_b, weight_b ).amount_in_precise( target );
+        if ( expected * 2 > reserve_a * 0.999 ) continue;
+        const uint64_t required = balancer::get_amount_in_fixed( target, reserve_a, weight_a, reserve_b, weight_b );
+        REQUIRE( balancer::get_amount_out_fixed( required, reserve_a, weight_a, reserve_b, weight_b ) >= target );
+        if ( required > 1 ) REQUIRE( balancer::get_amount_out_fixed( required - 1 - ( required >> 23 ), reserve_a, weight_a, reserve_b, weight_b ) < target );
+        if ( expected > 1e9 ) REQUIRE( required == Approx( expected ).epsilon( 1e-7 ) );
+        ++covered;
+    }
+    REQUIRE( covered > 2000 );
+
+    // out of range ratios are rejected as Balancer `calcOutGivenIn` / `calcInGivenOut`
+    recorded_check::message = nullptr;
+    balancer::get_amount_out_fixed<recorded_check>( reserve_in / 2 + 1, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
+    REQUIRE( std::string( recorded_check::message ) == "SX.Balancer: MAX_IN_RATIO" );
+    recorded_check::message = nullptr;
+    balancer::get_amount_in_fixed<recorded_check>( reserve_out / 3 + 1, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
+    REQUIRE( std::string( recorded_check::message ) == "SX.Balancer: MAX_OUT_RATIO" );
+    recorded_check::message = nullptr;
+    balancer::get_amount_in_fixed<recorded_check>( reserve_out / 4, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
+    REQUIRE( std::string( recorded_check::message ) == "SX.Balancer: MAX_IN_RATIO" );
+    recorded_check::message = nullptr;
+    balancer::get_amount_out_fixed<recorded_check>( reserve_in / 2, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
+    REQUIRE( recorded_check::message == nullptr );
+}
+
+TEST_CASE( "get_amount_out_with_fees (pass)" ) {
+    // Calculation
+    const balancer::fee_split split = balancer::get_amount_out_with_fees( 100000, 833515447, 20, 10395237882, 80, 25, 5 );
+
+    // Result
+    REQUIRE( split.amount_out == 310830 );
+    REQUIRE( split.trade_fee == 250 );
+    REQUIRE( split.protocol_fee == 50 );
+
+    // no fee
+    const balancer::fee_split none = balancer::get_amount_out_with_fees( 100000, 833515447, 20, 10395237882, 80, 0, 0 );
+    REQUIRE( none.amount_out == balancer::get_amount_out( 100000, 833515447, 20, 10395237882, 80, 0 ) );
+    REQUIRE( none.trade_fee == 0 );
+    REQUIRE( none.protocol_fee == 0 );
+
+    // fees above `uint8_t`, 50/50 exact integer curve
+    const balancer::fee_split wide = balancer::get_amount_out_with_fees( 100000, 833515447, 50, 10395237882, 50, 1000, 333 );
+    REQUIRE( wide.amount_out == static_cast<balancer::uint128>( 100000 ) * ( 10000 - 1333 ) * 10395237882 / ( static_cast<balancer::uint128>( 833515447 ) * 10000 + 100000 * ( 10000 - 1333 ) ) );
+    REQUIRE( wide.trade_fee == 10000 );
+    REQUIRE( wide.protocol_fee == 3330 );
+
+    // exact 50/50 inverse at the same combined fee covers the wide output
+    uint64_t amount_in = 0, amount_out = 0;
+    REQUIRE( balancer::detail::amount_in_equal( wide.amount_out, 833515447, 10395237882, 1333, amount_in ) );
+    REQUIRE( balancer::detail::amount_out_equal( amount_in, 833515447, 10395237882, 1333, amount_out ) );
+    REQUIRE( amount_in <= 100000 );
+    REQUIRE( amount_out >= wide.amount_out );
+
+    // one evaluation matches `get_amount_out` with the combined fee, fee amounts cover `ceil(amount_in * fee / 10000)`
+    std::mt19937_64 rng( 30 );
+    for ( size_t i = 0; i < 2000; ++i ) {
+        const uint64_t trade = rng();
+        const uint64_t reserve_in = 1000000 + rng() % 1000000000000;
+        const uint64_t amount_in = 1 + trade % std::min<uint64_t>( 1000000000, reserve_in / 2 );    // within MAX_IN_RATIO
+        const uint64_t reserve_out = 1000000 + rng() % 1000000000000;
+        const uint64_t weight_in = 1 + rng() % 99;
+        const uint64_t weight_out = i % 4 == 0 ? weight_in : 1 + rng() % 99;
+        const uint16_t trade_fee = rng() % 200;
+        const uint16_t protocol_fee = rng() % 56;
+        const balancer::fee_split r = balancer::get_amount_out_with_fees( amount_in, reserve_in, weight_in, reserve_out, weight_out, trade_fee, protocol_fee );
+        REQUIRE( r.amount_out == balancer::get_amount_out( amount_in, reserve_in, weight_in, reserve_out, weight_out, trade_fee + protocol_fee ) );
+        REQUIRE( r.trade_fee + r.protocol_fee == ( static_cast<balancer::uint128>( amount_in ) * ( trade_fee + protocol_fee ) + 9999 ) / 10000 );
+        REQUIRE( r.protocol_fee <= static_cast<balancer::uint128>( amount_in ) * protocol_fee / 10000 + 1 );
+    }
+}
+
+#if defined(BALANCER_FIXED_POINT)
+TEST_CASE( "on-chain profile (pass)" ) {
+    // equal weights, exact integer curve
+    REQUIRE( balancer::get_amount_out( 10000, 45851931234, 50000, 125682033533, 50000 ) == 27328 );
+    REQUIRE( balancer::get_amount_out( balancer::get_amount_in( 27328, 45851931234, 50000, 125682033533, 50000 ), 45851931234, 50000, 125682033533, 50000 ) >= 27328 );
+
+    // other weight ratios, fixed-point `bpow`
+    REQUIRE( balancer::get_amount_out( 100000, 833515447, 20, 10395237882, 80 ) == balancer::get_amount_out_fixed( 100000, 833515447, 20, 10395237882, 80 ) );
+    REQUIRE( balancer::get_amount_out<20, 80>( 100000, 833515447, 10395237882 ) == balancer::get_amount_out_fixed( 100000, 833515447, 20, 10395237882, 80 ) );
+    REQUIRE( balancer::get_amount_out( 100000, 833515447, 37, 10395237882, 61 ) == balancer::get_amount_out_fixed( 100000, 833515447, 37, 10395237882, 61 ) );
+    REQUIRE( balancer::get_amount_in( 310830, 833515447, 20, 10395237882, 80 ) == 100000 );
+
+    // 50/50 amounts above 64 bits fall back to fixed-point
+    REQUIRE( balancer::get_amount_out( 4000000000000000000ULL, 9000000000000000000ULL, 50, 9000000000000000000ULL, 50 ) == balancer::get_amount_out_fixed( 4000000000000000000ULL, 9000000000000000000ULL, 50, 9000000000000000000ULL, 50 ) );
+
+    // host paths stay on the double curve, within one unit plus `bpow` precision of the output reserve
+    std::mt19937_64 rng( 29 );
+    std::uniform_real_distribution<double> reserve_exp( 3, 18 );
+    std::uniform_real_distribution<double> share( 0, 0.5 );
+    for ( size_t i = 0; i < 20000; ++i ) {
+        const uint64_t reserve_in = pow( 10, reserve_exp( rng ) );
+        const uint64_t reserve_out = pow( 10, reserve_exp( rng ) );
+        const uint64_t weight_in = 1 + rng() % 99;
+        const uint64_t weight_out = 1 + rng() % 99;
+        const uint8_t fee = rng() % 100;
+        const uint64_t amount_in = 1 + static_cast<uint64_t>( reserve_in * share( rng ) * share( rng ) );
+        const uint64_t fixed = balancer::get_amount_out( amount_in, reserve_in, weight_in, reserve_out, weight_out, fee );
+        const uint64_t host = host_amount_out( amount_in, reserve_in, weight_in, reserve_out, weight_out, fee );
+        REQUIRE( ( fixed > host ? fixed - host : host - fixed ) <= 1 + static_cast<balancer::uint128>( reserve_out ) * balancer::BPOW_PRECISION / balancer::BONE );
+    }
+}
+#endif
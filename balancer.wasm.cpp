@@ -0,0 +1,41 @@
+#include <eosio/check.hpp>
+
+#include <stdint.h>
+
+#include "balancer.hpp"
+
+// One exported `run()` per module, selected by macro, for `wasm.sh`:
+//
+// - `BALANCER_WASM_BASELINE` - reads the inputs only, subtracted from every other module
+// - `BALANCER_WASM_AMOUNT_IN` - `get_amount_in` instead of `get_amount_out`
+// - `BALANCER_FIXED_POINT` - integer-only on-chain profile (see `balancer.hpp`)
+//
+// Inputs are `volatile` globals so the call is not folded at compile time. CDT builds (`__eosio_cdt__`) also export the
+// contract entry point `apply`, which calls `run()` once.
+
+static volatile uint64_t amount = 100000;
+static volatile uint64_t reserve_in = 833515447;
+static volatile uint64_t reserve_weight_in = 20;
+static volatile uint64_t reserve_out = 10395237882;
+static volatile uint64_t reserve_weight_out = 80;
+static volatile uint64_t amount_target = 310830;
+
+extern "C" __attribute__((export_name("run"))) uint64_t run()
+{
+#if defined(BALANCER_WASM_BASELINE)
+    return amount + reserve_in + reserve_weight_in + reserve_out + reserve_weight_out + amount_target;
+#elif defined(BALANCER_WASM_AMOUNT_IN)
+    return balancer::get_amount_in( amount_target, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
+#else
+    return balancer::get_amount_out( amount, reserve_in, reserve_weight_in, reserve_out, reserve_weight_out );
+#endif
+}
+
+#if defined(__eosio_cdt__)
+static volatile uint64_t result;
+
+extern "C" __attribute__((export_name("apply"))) void apply( uint64_t receiver, uint64_t code, uint64_t action )
+{
+    result = run();
+}
+#endif
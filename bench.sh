@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# compile (extra flags are forwarded, e.g. `./bench.sh -mavx2`)
+g++ -std=c++14 -O2 -pthread -o balancer.bench.out balancer.bench.cpp -I __bench__ -I __tests__ "$@"
+
+# bench
+./balancer.bench.out
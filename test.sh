@@ -1,8 +1,18 @@
 #!/bin/bash
 
 # compile
-g++ -std=c++11 -o balancer.t.out balancer.t.cpp -I __tests__
+g++ -std=c++14 -pthread -o balancer.t.out balancer.t.cpp -I __tests__
 
 # test
 ./balancer.t.out --success
 
+# compile & test with instrumentation counters
+g++ -std=c++14 -pthread -DBALANCER_INSTRUMENTATION -o balancer.t.out balancer.t.cpp -I __tests__
+./balancer.t.out --success
+
+# compile & test the integer-only on-chain profile
+g++ -std=c++14 -pthread -DBALANCER_FIXED_POINT -o balancer.t.out balancer.t.cpp -I __tests__
+./balancer.t.out --success
+
+# differential accuracy (scalar and AVX2 where supported), fails when a variant exceeds its error bound
+./accuracy.sh
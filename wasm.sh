@@ -0,0 +1,52 @@
+#!/bin/bash
+
+# WASM size & per-call instruction counts of the double path vs the `BALANCER_FIXED_POINT` on-chain profile
+#
+# builds with CDT (`cdt-cpp` / `eosio-cpp` on PATH), or else wasi-sdk (`WASI_SDK_PATH`, default `/opt/wasi-sdk`), and
+# counts instructions with wabt (`wasm-interp`). Skipped (exit 0) when no toolchain is found. Extra flags are forwarded,
+# e.g. `./wasm.sh -I ../sx.safemath/include`
+set -e
+
+if command -v cdt-cpp > /dev/null 2>&1 || command -v eosio-cpp > /dev/null 2>&1; then
+    CXX=$(command -v cdt-cpp || command -v eosio-cpp)
+    FLAGS=(-O=s --no-abigen)
+    INCLUDES=()                 # CDT ships `eosio/check.hpp` and 128-bit integers
+elif [ -x "${WASI_SDK_PATH:-/opt/wasi-sdk}/bin/clang++" ]; then
+    CXX="${WASI_SDK_PATH:-/opt/wasi-sdk}/bin/clang++"
+    FLAGS=(--target=wasm32-wasi -mexec-model=reactor -std=c++14 -Oz -fno-exceptions -Wl,--gc-sections -Wl,--strip-all)
+    INCLUDES=(-I __wasm__ -I __tests__)
+else
+    echo "wasm.sh: skipped, no cdt-cpp / eosio-cpp on PATH and no wasi-sdk at ${WASI_SDK_PATH:-/opt/wasi-sdk}" >&2
+    exit 0
+fi
+
+build() {
+    "$CXX" "${FLAGS[@]}" -o "balancer.wasm.$1.wasm" balancer.wasm.cpp "${INCLUDES[@]}" "${@:2}" "${EXTRA[@]}"
+}
+
+# traced instructions of every export (`run()` plus the reactor `_initialize` / CDT `apply`, cancelled by the baseline),
+# `-1` without wabt
+instructions() {
+    if command -v wasm-interp > /dev/null 2>&1; then
+        wasm-interp "balancer.wasm.$1.wasm" --dummy-import-func --run-all-exports --trace | grep -c '^#'
+    else
+        echo -1
+    fi
+}
+
+EXTRA=("$@")
+build baseline -DBALANCER_WASM_BASELINE
+build out
+build out_fixed -DBALANCER_FIXED_POINT
+build in -DBALANCER_WASM_AMOUNT_IN
+build in_fixed -DBALANCER_WASM_AMOUNT_IN -DBALANCER_FIXED_POINT
+
+base_bytes=$(wc -c < balancer.wasm.baseline.wasm)
+base_instructions=$(instructions baseline)
+for name in out out_fixed in in_fixed; do
+    bytes=$(wc -c < "balancer.wasm.$name.wasm")
+    count=$(instructions "$name")
+    [ "$count" -ge 0 ] && count=$((count - base_instructions))
+    printf '{"name": "%s", "compiler": "%s", "wasm_bytes": %d, "instructions": %d}\n' "$name" "$(basename "$CXX")" $((bytes - base_bytes)) "$count"
+done
+rm -f balancer.wasm.*.wasm